@@ -0,0 +1,711 @@
+// Reproducible benchmarks for both catalog implementations.
+//
+//   g++ -std=c++17 -O2 -pthread benchmark.cpp -o benchmark
+//   ./benchmark [--sizes 1K,10K,100K] [--ops N] [--seed S] [--zipf S]
+//               [--impl all|library|perpustakaan|engine] [--bench name,...] [--metrics N]
+//   ./benchmark --emit-batch [--sizes N] [--ops N] [--seed S] > trace.txt
+//
+// --impl engine runs the shared catalog engine (catalog_engine.hpp) directly,
+// once per policy combination ("engine:view/bst/vector/single" and so on,
+// "view+collated/..." with collated titles), to pick the configuration each
+// front-end should use.
+//
+// Every catalog and workload is a pure function of the seed, so two runs with
+// the same flags measure exactly the same operations. Results go to stdout as
+// JSON lines (one "meta" record, then one "result" record per benchmark);
+// a readable summary goes to stderr. Every operation is timed; percentiles come
+// from metrics.hpp's histogram, within 3% of the exact value. --metrics N turns on the catalogs' own
+// instrumentation (1 in N operations timed) to measure its overhead.
+#define LIBRARY_NO_MAIN
+#include "library.cpp"
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "perpustakaan.cpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace bench {
+
+// Swallows everything the catalogs print while they are being timed
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+class SplitMix64 {
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+private:
+    uint64_t state;
+};
+
+// Zipf(s) over ranks 1..n by rejection-inversion (Hoermann & Derflinger):
+// O(1) memory and time per sample, so it works for 10M-book catalogs
+class ZipfSampler {
+public:
+    ZipfSampler(uint64_t n, double s) : n(n), s(s) {
+        hIntegralX1 = hIntegral(1.5) - 1.0;
+        hIntegralN = hIntegral(n + 0.5);
+        cutoff = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    // Returns a rank in [0, n); rank 0 is the most popular
+    uint64_t sample(SplitMix64& rng) const {
+        while (true) {
+            double u = hIntegralN + rng.uniform() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1) k = 1;
+            if (k > n) k = n;
+            if (k - x <= cutoff || u >= hIntegral(k + 0.5) - h(k)) {
+                return static_cast<uint64_t>(k) - 1;
+            }
+        }
+    }
+
+private:
+    uint64_t n;
+    double s;
+    double hIntegralX1;
+    double hIntegralN;
+    double cutoff;
+
+    static double helper1(double x) {
+        return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    static double helper2(double x) {
+        return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+    }
+
+    double h(double x) const {
+        return std::exp(-s * std::log(x));
+    }
+
+    double hIntegral(double x) const {
+        double logX = std::log(x);
+        return helper2((1.0 - s) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - s);
+        if (t < -1.0) t = -1.0;
+        return std::exp(helper1(t) * x);
+    }
+};
+
+struct GeneratedBook {
+    std::string isbn;
+    std::string title;
+    std::string author;
+    std::string genre;
+    int year;
+    int copies;
+};
+
+// Book i of a catalog is a pure function of (seed, i): catalogs of any size
+// can be streamed without storing them, and book i is the same at every size.
+// Book index doubles as popularity rank for Zipf draws.
+class CatalogGenerator {
+public:
+    static const std::vector<std::string>& genres() {
+        static const std::vector<std::string> names = {
+            "Fiction", "Mystery", "Romance", "Science Fiction", "Fantasy", "Biography", "History",
+            "Computer Science", "Self-Help", "Children", "Young Adult", "Poetry", "Thriller",
+            "Horror", "Business", "Travel", "Cooking", "Art", "Philosophy", "Religion", "Science",
+            "Mathematics", "Health", "Sports", "Music", "Politics", "Psychology", "Education",
+            "Law", "Comics", "Drama", "Reference"};
+        return names;
+    }
+
+    CatalogGenerator(uint64_t seed, double genreSkew = 1.1)
+        : seed(seed), genreSampler(genres().size(), genreSkew), wordSampler(words().size(), 0.9),
+          surnameSampler(surnames().size(), 1.0) {}
+
+    GeneratedBook book(uint64_t i) const {
+        SplitMix64 rng(seed ^ (i * 0xD1B54A32D192ED03ULL));
+        GeneratedBook book;
+        book.isbn = isbn(i);
+        book.title = title(rng);
+        book.author = firstNames()[rng.next() % firstNames().size()] + " " + surnames()[surnameSampler.sample(rng)];
+        book.genre = genres()[genreSampler.sample(rng)];
+        double u = rng.uniform();
+        book.year = 2024 - static_cast<int>(124 * u * u * std::sqrt(u)); // Skewed towards recent years
+        double v = rng.uniform();
+        book.copies = 1 + static_cast<int>(4 * v * v);
+        return book;
+    }
+
+    // Distinct for every index below 10^9, in an order unrelated to the index
+    std::string isbn(uint64_t i) const {
+        uint64_t body = (i * 387420489ULL + (seed % 1000000000ULL)) % 1000000000ULL;
+        char digits[14];
+        snprintf(digits, sizeof(digits), "978%09llu", static_cast<unsigned long long>(body));
+        int sum = 0;
+        for (int d = 0; d < 12; ++d) {
+            sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+        }
+        digits[12] = static_cast<char>('0' + (10 - sum % 10) % 10);
+        digits[13] = '\0';
+        return digits;
+    }
+
+    const std::string& genreByRank(uint64_t rank) const {
+        return genres()[rank % genres().size()];
+    }
+
+private:
+    uint64_t seed;
+    ZipfSampler genreSampler;
+    ZipfSampler wordSampler;
+    ZipfSampler surnameSampler;
+
+    static const std::vector<std::string>& words() {
+        static const std::vector<std::string> list = {
+            "Love", "Night", "Time", "World", "House", "Shadow", "Secret", "Life", "Story", "Dark",
+            "Light", "Girl", "King", "Garden", "City", "River", "War", "Dream", "Heart", "Fire",
+            "Moon", "Summer", "Winter", "Blood", "Star", "Sea", "Road", "Last", "First", "Lost",
+            "Silent", "Broken", "Golden", "Hidden", "Wild", "Little", "Great", "Empire", "Island",
+            "Mountain", "Journey", "Memory", "Promise", "Truth", "Game", "Song", "Storm", "Stone",
+            "Winds", "Letters", "Children", "Kingdom", "Forest", "Echoes", "Ashes", "Bones",
+            "Glass", "Silver", "Iron", "Crown", "Algorithms", "Data", "Structures", "Systems",
+            "Introduction", "Principles", "Guide", "Handbook", "History", "Theory", "Practice",
+            "Modern", "Ancient", "Art", "Science", "Mind", "Code", "Machine", "Learning", "Design",
+            "Patterns", "Café", "Élan", "Señor", "Naïve", "Über", "Déjà", "Vu", "Beyond", "Under",
+            "Between", "Without", "Forever", "Tomorrow", "Yesterday", "Midnight", "Paris",
+            "London", "Tokyo", "Jakarta", "Bandung", "Surabaya"};
+        return list;
+    }
+
+    static const std::vector<std::string>& firstNames() {
+        static const std::vector<std::string> list = {
+            "Ahmad", "Budi", "Citra", "Dewi", "Eka", "Fajar", "Gita", "Hadi", "Indah", "Joko",
+            "Kartika", "Lestari", "Maya", "Nanda", "Oscar", "Putri", "Rina", "Sari", "Taufik",
+            "Umar", "Vina", "Wulan", "Yusuf", "Zahra", "Alice", "Bob", "Carol", "David", "Emma",
+            "Frank", "Grace", "Henry", "Isabel", "James", "Karen", "Liam", "Mary", "Noah",
+            "Olivia", "Peter"};
+        return list;
+    }
+
+    static const std::vector<std::string>& surnames() {
+        static const std::vector<std::string> list = {
+            "Santoso", "Wijaya", "Pratama", "Kusuma", "Hidayat", "Saputra", "Nugroho", "Halim",
+            "Siregar", "Nasution", "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia",
+            "Miller", "Davis", "Martinez", "Lopez", "Wilson", "Anderson", "Thomas", "Taylor",
+            "Moore", "Jackson", "Martin", "Lee", "Thompson", "White", "Harris", "Clark", "Lewis",
+            "Robinson", "Walker", "Young", "Allen", "King", "Wright", "Scott", "Knuth", "Tarjan",
+            "Cormen", "Sedgewick", "Dijkstra", "Hoare", "Liskov", "Hopper", "Lovelace", "Turing"};
+        return list;
+    }
+
+    // 1-8 words, mostly 2-4; about one title in six starts with an article
+    std::string title(SplitMix64& rng) const {
+        static const int wordCounts[] = {1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 5, 5, 6, 7, 8};
+        int count = wordCounts[rng.next() % 16];
+        std::string result;
+        uint64_t article = rng.next() % 12;
+        if (article == 0) result = "The ";
+        if (article == 1) result = "A ";
+        for (int w = 0; w < count; ++w) {
+            if (w > 0) result += (w == count / 2 && count > 3 && rng.next() % 3 == 0) ? " of the " : " ";
+            result += words()[wordSampler.sample(rng)];
+        }
+        // Long catalogs repeat word combinations; a volume number keeps most titles distinct
+        if (rng.next() % 4 == 0) result += " " + std::to_string(1 + rng.next() % 12);
+        return result;
+    }
+};
+
+// Same operations on both catalogs; every call is what a real caller would do
+class LibraryAdapter {
+public:
+    static constexpr const char* name = "library";
+    static constexpr bool hasGraph = true;
+
+    LibraryAdapter() {
+        library.setQuiet(true);
+    }
+
+    void add(const GeneratedBook& book) {
+        library.addBook(book.isbn, book.title, book.author, book.genre);
+    }
+
+    bool searchIsbn(const std::string& isbn) {
+        return library.searchByISBN(isbn) != nullptr;
+    }
+
+    bool searchTitle(const std::string& title) {
+        return library.searchByTitle(title) != nullptr;
+    }
+
+    void borrow(const std::string& isbn) {
+        library.requestBorrow("bench", isbn);
+        library.processNextRequest();
+    }
+
+    void giveBack(const std::string& isbn) {
+        library.requestReturn("bench", isbn);
+        library.processNextRequest();
+    }
+
+    void undo() {
+        library.undoLastAction();
+    }
+
+    void genreList(const std::string& genre) {
+        library.displayBooksByGenre(genre);
+    }
+
+    void buildRecommendations() {
+        library.buildRecommendations();
+    }
+
+    void recommend(const GeneratedBook& book) {
+        library.getRecommendations(book.isbn);
+    }
+
+private:
+    LibrarySystem library;
+};
+
+class PerpustakaanAdapter {
+public:
+    static constexpr const char* name = "perpustakaan";
+    static constexpr bool hasGraph = false;
+
+    PerpustakaanAdapter() {
+        perpustakaan.aturModeSenyap(true);
+    }
+
+    void add(const GeneratedBook& book) {
+        perpustakaan.tambahBuku(book.title, book.author, book.isbn, book.genre, book.year, book.copies);
+    }
+
+    bool searchIsbn(const std::string& isbn) {
+        return perpustakaan.cariBukuBerdasarkanISBN(isbn) != nullptr;
+    }
+
+    bool searchTitle(const std::string& title) {
+        return perpustakaan.cariBukuBerdasarkanJudul(title) != nullptr;
+    }
+
+    void borrow(const std::string& isbn) {
+        perpustakaan.ajukanPermintaanPinjam(isbn, true);
+        perpustakaan.prosesAntrian();
+    }
+
+    void giveBack(const std::string& isbn) {
+        perpustakaan.ajukanPermintaanKembali(isbn, true);
+        perpustakaan.prosesAntrian();
+    }
+
+    void undo() {
+        perpustakaan.undoTindakanTerakhir();
+    }
+
+    void genreList(const std::string& genre) {
+        perpustakaan.penyaji.tulisBaris("");
+        for (const auto& buku : perpustakaan.dapatkanBukuDariGenre(genre)) {
+            perpustakaan.penyaji.sajikan(*buku);
+        }
+        perpustakaan.penyaji.flush();
+    }
+
+    // Recommendations are computed per query from the genre index; nothing to build
+    void buildRecommendations() {}
+
+    void recommend(const GeneratedBook& book) {
+        perpustakaan.rekomendasikanBuku(book.genre);
+    }
+
+private:
+    Perpustakaan perpustakaan;
+};
+
+struct Options {
+    std::vector<uint64_t> sizes = {1000, 10000, 100000};
+    uint64_t ops = 100000;
+    uint64_t seed = 42;
+    double zipf = 1.0;
+    std::string impl = "all";
+    std::vector<std::string> benches; // Empty: all
+    bool emitBatch = false;
+    uint32_t metrics = 0; // 0: catalog instrumentation off
+};
+
+// Catalogs whose all-pairs genre graph would not fit in memory skip the build
+constexpr uint64_t MAX_GRAPH_BOOKS = 20000;
+
+class Runner {
+public:
+    Runner(const Options& options, std::ostream& results) : options(options), results(results) {}
+
+    bool enabled(const std::string& bench) const {
+        return options.benches.empty() ||
+               std::find(options.benches.begin(), options.benches.end(), bench) != options.benches.end();
+    }
+
+    // Times `op(i)` for i in [0, count), one clock pair per call
+    template <typename Op>
+    void measure(const char* impl, const std::string& bench, uint64_t books, uint64_t count, Op op) {
+        latencies.clear();
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            op(i);
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start).count();
+            latencies.record(ns);
+            total += ns;
+        }
+        report(impl, bench, books, count, total);
+    }
+
+    void skip(const char* impl, const std::string& bench, uint64_t books, const char* reason) {
+        results << "{\"type\":\"result\",\"impl\":\"" << impl << "\",\"bench\":\"" << bench
+                << "\",\"books\":" << books << ",\"skipped\":\"" << reason << "\"}\n";
+        std::cerr << "  " << bench << ": skipped (" << reason << ")\n";
+    }
+
+    template <typename Adapter>
+    void run(uint64_t books) {
+        const char* impl = Adapter::name;
+        std::cerr << impl << ", " << books << " books\n";
+        CatalogGenerator generator(options.seed);
+        ZipfSampler popularity(books, options.zipf);
+        std::unique_ptr<Adapter> catalog(new Adapter());
+        uint64_t ops = options.ops;
+
+        // Macro: full catalog build, always run since everything else needs it
+        measure(impl, "add", books, books, [&](uint64_t i) { catalog->add(generator.book(i)); });
+
+        // Point lookups follow borrow popularity; keys are generated up front
+        std::vector<GeneratedBook> hot;
+        SplitMix64 rng(options.seed ^ books);
+        hot.reserve(ops);
+        for (uint64_t i = 0; i < ops; ++i) hot.push_back(generator.book(popularity.sample(rng)));
+
+        size_t sink = 0;
+        if (enabled("search_isbn")) {
+            measure(impl, "search_isbn", books, ops, [&](uint64_t i) { sink += catalog->searchIsbn(hot[i].isbn); });
+        }
+        if (enabled("search_title")) {
+            measure(impl, "search_title", books, ops, [&](uint64_t i) { sink += catalog->searchTitle(hot[i].title); });
+        }
+        if (enabled("search_miss")) {
+            std::vector<std::string> missing;
+            missing.reserve(ops);
+            for (uint64_t i = 0; i < ops; ++i) missing.push_back(generator.isbn(books + i));
+            measure(impl, "search_miss", books, ops, [&](uint64_t i) { sink += catalog->searchIsbn(missing[i]); });
+        }
+        if (enabled("borrow")) {
+            measure(impl, "borrow", books, ops, [&](uint64_t i) { catalog->borrow(hot[i].isbn); });
+        }
+        if (enabled("return")) {
+            measure(impl, "return", books, ops, [&](uint64_t i) { catalog->giveBack(hot[i].isbn); });
+        }
+        if (enabled("undo")) {
+            measure(impl, "undo", books, ops, [&](uint64_t) { catalog->undo(); });
+        }
+        // Listings are O(books in genre); fewer repetitions keep large sizes practical
+        uint64_t listings = std::max<uint64_t>(10, std::min<uint64_t>(ops, 10000000 / books));
+        if (enabled("genre_list")) {
+            ZipfSampler genreRank(CatalogGenerator::genres().size(), 1.1);
+            measure(impl, "genre_list", books, listings, [&](uint64_t) {
+                catalog->genreList(generator.genreByRank(genreRank.sample(rng)));
+            });
+        }
+        bool graphBuilt = !Adapter::hasGraph;
+        if (enabled("recommend_build")) {
+            if (!Adapter::hasGraph) {
+                skip(impl, "recommend_build", books, "no graph to build");
+            } else if (books > MAX_GRAPH_BOOKS) {
+                skip(impl, "recommend_build", books, "graph is quadratic in genre size");
+            } else {
+                measure(impl, "recommend_build", books, 1, [&](uint64_t) { catalog->buildRecommendations(); });
+                graphBuilt = true;
+            }
+        }
+        if (enabled("recommend")) {
+            if (!graphBuilt) {
+                skip(impl, "recommend", books, "graph not built");
+            } else {
+                measure(impl, "recommend", books, listings, [&](uint64_t i) { catalog->recommend(hot[i]); });
+            }
+        }
+
+        // Macro: a search-heavy mix with Zipf popularity, reported as one number
+        if (enabled("mixed")) {
+            SplitMix64 mixRng(options.seed * 31 + books);
+            measure(impl, "mixed", books, ops, [&](uint64_t i) {
+                const GeneratedBook& book = hot[i];
+                uint64_t pick = mixRng.next() % 1000;
+                if (pick < 700) {
+                    sink += catalog->searchIsbn(book.isbn);
+                } else if (pick < 850) {
+                    sink += catalog->searchTitle(book.title);
+                } else if (pick < 920) {
+                    catalog->borrow(book.isbn);
+                } else if (pick < 990) {
+                    catalog->giveBack(book.isbn);
+                } else if (pick < 998) {
+                    catalog->undo();
+                } else if (books <= 100000) {
+                    catalog->genreList(book.genre);
+                } else {
+                    sink += catalog->searchIsbn(book.isbn);
+                }
+            });
+        }
+        if (sink == SIZE_MAX) std::cerr << sink; // Keeps lookups from being optimised away
+    }
+
+    // The engine alone: no queues, no printing, just the indexes and buckets
+    template <typename Engine>
+    void runEngine(uint64_t books) {
+        std::string label = "engine:" + Engine::configuration();
+        const char* impl = label.c_str();
+        std::cerr << impl << ", " << books << " books\n";
+        CatalogGenerator generator(options.seed);
+        ZipfSampler popularity(books, options.zipf);
+        std::unique_ptr<Engine> engine(new Engine());
+        uint64_t ops = options.ops;
+
+        std::vector<std::shared_ptr<Book>> records;
+        records.reserve(books);
+        for (uint64_t i = 0; i < books; ++i) {
+            GeneratedBook book = generator.book(i);
+            records.push_back(std::make_shared<Book>(book.isbn, book.title, book.author, book.genre));
+        }
+        measure(impl, "add", books, books, [&](uint64_t i) { engine->insert(records[i]); });
+
+        std::vector<GeneratedBook> hot;
+        SplitMix64 rng(options.seed ^ books);
+        hot.reserve(ops);
+        for (uint64_t i = 0; i < ops; ++i) hot.push_back(generator.book(popularity.sample(rng)));
+
+        size_t sink = 0;
+        if (enabled("search_isbn")) {
+            measure(impl, "search_isbn", books, ops, [&](uint64_t i) { sink += engine->findByISBN(hot[i].isbn) != nullptr; });
+        }
+        if (enabled("search_title")) {
+            measure(impl, "search_title", books, ops, [&](uint64_t i) { sink += engine->findByTitle(hot[i].title) != nullptr; });
+        }
+        if (enabled("search_miss")) {
+            std::vector<std::string> missing;
+            missing.reserve(ops);
+            for (uint64_t i = 0; i < ops; ++i) missing.push_back(generator.isbn(books + i));
+            measure(impl, "search_miss", books, ops, [&](uint64_t i) { sink += engine->findByISBN(missing[i]) != nullptr; });
+        }
+        uint64_t listings = std::max<uint64_t>(10, std::min<uint64_t>(ops, 10000000 / books));
+        if (enabled("genre_list")) {
+            ZipfSampler genreRank(CatalogGenerator::genres().size(), 1.1);
+            measure(impl, "genre_list", books, listings, [&](uint64_t) {
+                engine->visitGenre(generator.genreByRank(genreRank.sample(rng)),
+                                   [&sink](const std::shared_ptr<Book>&) { ++sink; });
+            });
+        }
+        // One page of 50 from a random rank, in title order
+        if (enabled("page")) {
+            uint64_t pages = std::min<uint64_t>(ops, 10000);
+            measure(impl, "page", books, pages, [&](uint64_t) {
+                auto cursor = engine->seekRank(rng.next() % books, true);
+                sink += Engine::visitPage(cursor, 50, [](const Book&) {});
+            });
+        }
+        // Every other book, then the tombstone sweep that follows
+        if (enabled("remove")) {
+            measure(impl, "remove", books, books / 2, [&](uint64_t i) { engine->remove(records[2 * i]); });
+            measure(impl, "compact", books, 1, [&](uint64_t) { while (engine->compact(4096)) {} });
+        }
+        if (sink == SIZE_MAX) std::cerr << sink;
+    }
+
+    // Both concurrency policies for one key/index/bucket combination
+    template <typename Key, template <typename, typename> class Index, template <typename> class Buckets,
+              typename TitleKey = Key>
+    void runEngines(uint64_t books) {
+        runEngine<catalog::Engine<Book, Key, Index, Buckets, catalog::SingleThreaded, TitleKey>>(books);
+        runEngine<catalog::Engine<Book, Key, Index, Buckets, catalog::SharedLock, TitleKey>>(books);
+    }
+
+private:
+    const Options& options;
+    std::ostream& results;
+    metrics::Histogram latencies; // Percentiles within 3%, the same buckets as --metrics
+
+    void report(const char* impl, const std::string& bench, uint64_t books, uint64_t count, uint64_t totalNs) {
+        double seconds = totalNs / 1e9;
+        double nsPerOp = count ? static_cast<double>(totalNs) / count : 0;
+        uint64_t p50 = latencies.percentile(0.50);
+        uint64_t p99 = latencies.percentile(0.99);
+        uint64_t p999 = latencies.percentile(0.999);
+        uint64_t maximum = latencies.max();
+        results << "{\"type\":\"result\",\"impl\":\"" << impl << "\",\"bench\":\"" << bench
+                << "\",\"books\":" << books << ",\"ops\":" << count << ",\"seconds\":" << seconds
+                << ",\"ns_per_op\":" << nsPerOp << ",\"ops_per_sec\":" << (seconds > 0 ? count / seconds : 0)
+                << ",\"p50_ns\":" << p50 << ",\"p99_ns\":" << p99 << ",\"p999_ns\":" << p999
+                << ",\"max_ns\":" << maximum << "}\n";
+        results.flush();
+
+        std::string label = bench;
+        label.resize(16, ' ');
+        std::cerr << "  " << label << nsPerOp << " ns/op, p99 " << p99 << " ns\n";
+    }
+};
+
+// Writes a perpustakaan --batch trace: the catalog as A lines, then the mixed workload
+void emitBatch(const Options& options, std::ostream& out) {
+    uint64_t books = options.sizes.front();
+    CatalogGenerator generator(options.seed);
+    ZipfSampler popularity(books, options.zipf);
+    SplitMix64 rng(options.seed ^ books);
+    std::string line;
+    for (uint64_t i = 0; i < books; ++i) {
+        GeneratedBook book = generator.book(i);
+        out << "A\t" << book.title << '\t' << book.author << '\t' << book.isbn << '\t' << book.genre << '\t'
+            << book.year << '\t' << book.copies << '\n';
+    }
+    for (uint64_t i = 0; i < options.ops; ++i) {
+        GeneratedBook book = generator.book(popularity.sample(rng));
+        uint64_t pick = rng.next() % 1000;
+        if (pick < 700) {
+            out << "S\tI\t" << book.isbn << '\n';
+        } else if (pick < 850) {
+            out << "S\tJ\t" << book.title << '\n';
+        } else if (pick < 920) {
+            out << "B\tI\t" << book.isbn << '\n';
+        } else if (pick < 990) {
+            out << "R\tI\t" << book.isbn << '\n';
+        } else if (pick < 998) {
+            out << "U\n";
+        } else {
+            out << "G\t" << book.genre << '\n';
+        }
+        if (i % 16 == 15) out << "P\n";
+    }
+}
+
+// Accepts plain numbers and K/M suffixes: "1K,10K,10M"
+bool parseSizes(const std::string& text, std::vector<uint64_t>& sizes) {
+    sizes.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(start, end - start);
+        uint64_t multiplier = 1;
+        if (!item.empty() && (item.back() == 'K' || item.back() == 'k')) multiplier = 1000;
+        if (!item.empty() && (item.back() == 'M' || item.back() == 'm')) multiplier = 1000000;
+        if (multiplier > 1) item.pop_back();
+        char* rest = nullptr;
+        unsigned long long value = std::strtoull(item.c_str(), &rest, 10);
+        if (item.empty() || *rest != '\0' || value == 0) return false;
+        sizes.push_back(value * multiplier);
+        start = end + 1;
+    }
+    return !sizes.empty();
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sizes" && hasValue) {
+            if (!parseSizes(argv[++i], options.sizes)) return false;
+        } else if (arg == "--ops" && hasValue) {
+            options.ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--zipf" && hasValue) {
+            options.zipf = std::atof(argv[++i]);
+        } else if (arg == "--impl" && hasValue) {
+            options.impl = argv[++i];
+        } else if (arg == "--bench" && hasValue) {
+            std::string list = argv[++i];
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t end = list.find(',', start);
+                if (end == std::string::npos) end = list.size();
+                options.benches.push_back(list.substr(start, end - start));
+                start = end + 1;
+            }
+        } else if (arg == "--metrics" && hasValue) {
+            options.metrics = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--emit-batch") {
+            options.emitBatch = true;
+        } else {
+            return false;
+        }
+    }
+    return options.ops > 0 && options.zipf > 0 &&
+           (options.impl == "all" || options.impl == "library" || options.impl == "perpustakaan" ||
+            options.impl == "engine");
+}
+
+} // namespace bench
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    bench::Options options;
+    if (!bench::parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 1K,10K,100K] [--ops N] [--seed S] [--zipf S]\n"
+                  << "       [--impl all|library|perpustakaan|engine] [--bench name,...] [--metrics N] [--emit-batch]\n";
+        return 1;
+    }
+    if (options.emitBatch) {
+        bench::emitBatch(options, std::cout);
+        return 0;
+    }
+
+    if (options.metrics > 0) {
+        Metrics::enable(options.metrics);
+        Metrik::aktifkan(options.metrics);
+    }
+
+    // Catalog output goes nowhere; results keep the real stdout
+    bench::NullBuffer nullBuffer;
+    std::ostream results(std::cout.rdbuf(&nullBuffer));
+    results << "{\"type\":\"meta\",\"seed\":" << options.seed << ",\"ops\":" << options.ops
+            << ",\"zipf\":" << options.zipf << ",\"metrics\":" << options.metrics << ",\"sizes\":[";
+    for (size_t i = 0; i < options.sizes.size(); ++i) {
+        results << (i ? "," : "") << options.sizes[i];
+    }
+    results << "],\"compiler\":\"" << __VERSION__ << "\",\"threads\":" << std::thread::hardware_concurrency() << "}\n";
+
+    bench::Runner runner(options, results);
+    for (uint64_t books : options.sizes) {
+        if (options.impl == "engine") {
+            runner.runEngines<catalog::OwnedKey, catalog::MapIndex, catalog::MapBuckets>(books);
+            runner.runEngines<catalog::OwnedKey, catalog::MapIndex, catalog::VectorBuckets>(books);
+            runner.runEngines<catalog::OwnedKey, catalog::BstIndex, catalog::MapBuckets>(books);
+            runner.runEngines<catalog::OwnedKey, catalog::BstIndex, catalog::VectorBuckets>(books);
+            runner.runEngines<catalog::ViewKey, catalog::MapIndex, catalog::MapBuckets>(books);
+            runner.runEngines<catalog::ViewKey, catalog::MapIndex, catalog::VectorBuckets>(books);
+            runner.runEngines<catalog::ViewKey, catalog::BstIndex, catalog::MapBuckets>(books);
+            runner.runEngines<catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets>(books);
+            // Collated titles, as both front-ends use them; search_title includes normalising the probe
+            runner.runEngines<catalog::ViewKey, catalog::MapIndex, catalog::MapBuckets, catalog::CollatedKey>(books);
+            runner.runEngines<catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets, catalog::CollatedKey>(books);
+            continue;
+        }
+        if (options.impl != "perpustakaan") runner.run<bench::LibraryAdapter>(books);
+        if (options.impl != "library") runner.run<bench::PerpustakaanAdapter>(books);
+    }
+    std::cout.rdbuf(results.rdbuf());
+    return 0;
+}
@@ -0,0 +1,1303 @@
+// Catalog engine shared by library.cpp and perpustakaan.cpp.
+//
+// One templated core holds the records and their ISBN index, title index and
+// genre buckets. Every structural choice is a compile-time policy, so each
+// configuration is a separate specialisation with no virtual dispatch:
+//
+//   Engine<Record, KeyPolicy, OrderedIndex, GenreStorage, Concurrency, TitleKeyPolicy>
+//
+//   KeyPolicy     OwnedKey (index keeps its own string) or ViewKey (view into
+//                 the record, which the index entry keeps alive)
+//   TitleKeyPolicy  KeyPolicy by default, or CollatedKey (precomputed case-
+//                 and accent-insensitive sort key) for the title index only
+//   OrderedIndex  MapIndex (std::map) or BstIndex (size-augmented BST with
+//                 O(h) rank seek)
+//   GenreStorage  VectorBuckets (genres in first-seen order, linear lookup)
+//                 or MapBuckets (genres sorted, O(log g) lookup)
+//   Concurrency   SingleThreaded (no locking) or SharedLock (shared_mutex)
+//
+// Front-ends specialise catalog::RecordTraits for their book type. No hash
+// containers are used anywhere (library.cpp forbids them).
+#ifndef CATALOG_ENGINE_HPP
+#define CATALOG_ENGINE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace catalog {
+
+// --- Memory accounting ---
+// Sizes are modelled, not measured: each heap block is charged what glibc
+// malloc hands out for it (8-byte header, 16-byte granularity, 32 minimum).
+// `live` is the bytes that hold data, `overhead` everything else: node
+// links, shared_ptr control blocks, rounding, unused capacity, tombstones.
+
+inline size_t allocationSize(size_t requested) {
+    size_t block = (requested + sizeof(size_t) + 2 * sizeof(size_t) - 1) & ~(2 * sizeof(size_t) - 1);
+    return std::max(block, 4 * sizeof(size_t));
+}
+
+// make_shared puts a vtable pointer and two counts before the object
+constexpr size_t CONTROL_BLOCK = 2 * sizeof(void*);
+// Colour and three links ahead of every std::map value
+constexpr size_t MAP_NODE_HEADER = 4 * sizeof(void*);
+
+struct MemoryUsage {
+    size_t live = 0;
+    size_t overhead = 0;
+
+    size_t total() const { return live + overhead; }
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        live += other.live;
+        overhead += other.overhead;
+        return *this;
+    }
+
+    // One heap block of `requested` bytes of which `used` hold data
+    void allocation(size_t used, size_t requested) {
+        if (requested == 0) return;
+        live += used;
+        overhead += allocationSize(requested) - used;
+    }
+
+    // Heap part of a string; short strings live inside the object itself
+    void string(const std::string& text) {
+        const char* data = text.data();
+        const char* object = reinterpret_cast<const char*>(&text);
+        if (data >= object && data < object + sizeof(text)) return;
+        allocation(text.size(), text.capacity() + 1);
+    }
+
+    // A std::deque (queue/stack) of `count` elements: 512-byte blocks plus the block map
+    template <typename T>
+    void deque(size_t count) {
+        size_t perBlock = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+        size_t blocks = count / perBlock + 1;
+        live += count * sizeof(T);
+        overhead += blocks * allocationSize(perBlock * sizeof(T)) - count * sizeof(T);
+        allocation(0, std::max<size_t>(8, blocks + 2) * sizeof(void*));
+    }
+};
+
+// Hands pages freed by compaction back to the OS where the allocator keeps
+// them cached (glibc); elsewhere freed memory is already returned or reused
+inline void releaseMemory() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+// Specialise for each record type:
+//   static const std::string& isbn(const Record&);
+//   static const std::string& title(const Record&);
+//   static const std::string& genre(const Record&);
+//   static bool deleted(const Record&);
+//   static void markDeleted(Record&);
+//   static void memory(const Record&, MemoryUsage&); // Heap owned by the record
+template <typename Record>
+struct RecordTraits;
+
+// --- Key policies ---
+// Key is what an index stores, Probe is what a lookup compares against it;
+// matches(key, probe) says whether a lookup for `probe` accepts the entry.
+
+struct OwnedKey {
+    static constexpr const char* name = "owned";
+    using Key = std::string;
+    using Probe = std::string_view;
+
+    static Key make(const std::string& field) { return field; }
+    static Probe probe(std::string_view text) { return text; }
+    static int compare(std::string_view a, std::string_view b) { return a.compare(b); }
+    static bool matches(std::string_view key, std::string_view probe) { return key == probe; }
+    static void memory(const Key& key, MemoryUsage& usage) { usage.string(key); }
+};
+
+// Indexed fields are never modified in place (updates insert a new record),
+// so a view into the record stays valid for as long as the entry exists
+struct ViewKey {
+    static constexpr const char* name = "view";
+    using Key = std::string_view;
+    using Probe = std::string_view;
+
+    static Key make(const std::string& field) { return field; }
+    static Probe probe(std::string_view text) { return text; }
+    static int compare(std::string_view a, std::string_view b) { return a.compare(b); }
+    static bool matches(std::string_view key, std::string_view probe) { return key == probe; }
+    static void memory(const Key&, MemoryUsage&) {}
+};
+
+namespace detail {
+
+// Base letters for U+00C0..U+017F. '*' marks the ligatures spelled out in
+// foldLatin(); '?' marks the two symbols that are kept as they are (U+00D7, U+00F7).
+constexpr char LATIN_BASE[] =
+    "aaaaaa*ceeeeiiiidnooooo?ouuuuy**aaaaaa*ceeeeiiiidnooooo?ouuuuy*y"
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkkllllllllll"
+    "nnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+static_assert(sizeof(LATIN_BASE) == 0x180 - 0xC0 + 1, "one entry per code point");
+
+// Appends the unaccented lower-case spelling of `codePoint` (U+00C0..U+017F);
+// false if it is not a letter
+inline bool foldLatin(unsigned codePoint, std::string& out) {
+    char base = LATIN_BASE[codePoint - 0xC0];
+    if (base == '?') return false;
+    if (base != '*') {
+        out += base;
+        return true;
+    }
+    switch (codePoint) {
+        case 0xC6: case 0xE6: out += "ae"; break;
+        case 0xDE: case 0xFE: out += "th"; break;
+        case 0xDF: out += "ss"; break;
+        case 0x132: case 0x133: out += "ij"; break;
+        default: out += "oe"; break; // U+0152, U+0153
+    }
+    return true;
+}
+
+} // namespace detail
+
+// Orders titles the way a reader expects. Case is folded, accents are
+// stripped (Latin-1 and Latin Extended-A letters, combining marks), runs of
+// whitespace become one space, and a leading "the", "a" or "an" is dropped.
+// Titles that normalise alike stay distinct keys, ordered by their original
+// bytes; a lookup probe has no original bytes, so it sorts before all of them
+// and matches any. The key is normalised once, at insert or at the start of
+// a lookup. A comparison then checks the first 8 bytes as one
+// integer, and memcmps the rest only on a tie.
+struct CollatedKey {
+    static constexpr const char* name = "collated";
+    static constexpr size_t PREFIX = sizeof(uint64_t);
+
+    struct Key {
+        uint64_t prefix = 0;    // First PREFIX bytes, big-endian, zero padded
+        std::string rest;       // Bytes after the prefix; short titles need no heap
+        std::string_view title; // The title as given, into the record as with ViewKey
+    };
+    using Probe = Key;
+
+    // Normalised text never contains a zero byte, so the padding sorts a key
+    // before every longer key that extends it, as a byte compare would
+    static std::string normalize(std::string_view text) {
+        std::string out;
+        out.reserve(text.size());
+        bool space = false;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = text[i];
+            unsigned char next = i + 1 < text.size() ? text[i + 1] : 0;
+            bool continuation = (next & 0xC0) == 0x80;
+            if (c == ' ' || (c >= '\t' && c <= '\r') || (c == 0xC2 && next == 0xA0)) {
+                space = !out.empty();
+                if (c == 0xC2) ++i;
+                continue;
+            }
+            if (c < 0x20 || c == 0x7F) continue;
+            if ((c == 0xCC || (c == 0xCD && next <= 0xAF)) && continuation) {
+                ++i; // Combining mark U+0300..U+036F
+                continue;
+            }
+            if (space) out += ' ';
+            space = false;
+            if (c >= 0xC3 && c <= 0xC5 && continuation &&
+                detail::foldLatin((c & 0x1F) << 6 | (next & 0x3F), out)) {
+                ++i;
+            } else if (c >= 'A' && c <= 'Z') {
+                out += static_cast<char>(c - 'A' + 'a');
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+        for (std::string_view article : {"the ", "a ", "an "}) {
+            if (out.size() > article.size() && out.compare(0, article.size(), article) == 0) {
+                out.erase(0, article.size());
+                break;
+            }
+        }
+        return out;
+    }
+
+    static uint64_t prefixOf(const std::string& text) {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < PREFIX; ++i) {
+            prefix = prefix << 8 | (i < text.size() ? static_cast<unsigned char>(text[i]) : 0);
+        }
+        return prefix;
+    }
+
+    // Stored keys copy the tail at its exact size
+    static Key make(const std::string& field) {
+        std::string text = normalize(field);
+        return Key{prefixOf(text), text.size() > PREFIX ? text.substr(PREFIX) : std::string(), field};
+    }
+
+    // A probe lives for one lookup, so it keeps the normalised buffer
+    static Probe probe(std::string_view text) {
+        Probe key{0, normalize(text), std::string_view()};
+        key.prefix = prefixOf(key.rest);
+        key.rest.erase(0, std::min(PREFIX, key.rest.size()));
+        return key;
+    }
+    static int compare(const Key& a, const Key& b) {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix ? -1 : 1;
+        if (int c = a.rest.compare(b.rest)) return c;
+        return a.title.compare(b.title);
+    }
+    static bool matches(const Key& key, const Probe& probe) {
+        return key.prefix == probe.prefix && key.rest == probe.rest;
+    }
+    static void memory(const Key& key, MemoryUsage& usage) { usage.string(key.rest); }
+};
+
+// The engine's title index key: the title key, then the record's ISBN, so each
+// record has its own entry and records sharing a title sort by ISBN. A lookup
+// probes with the title alone, which sorts before every entry with that title,
+// and gets the first of them.
+template <typename TitleKeyPolicy, typename IsbnKeyPolicy>
+struct TitleEntryKey {
+    static constexpr const char* name = TitleKeyPolicy::name;
+
+    struct Key {
+        typename TitleKeyPolicy::Key title;
+        typename IsbnKeyPolicy::Key isbn;
+    };
+    using Probe = typename TitleKeyPolicy::Probe;
+
+    static Key make(const std::string& title, const std::string& isbn) {
+        return Key{TitleKeyPolicy::make(title), IsbnKeyPolicy::make(isbn)};
+    }
+    static Probe probe(std::string_view title) { return TitleKeyPolicy::probe(title); }
+
+    static int compare(const Key& a, const Key& b) {
+        if (int c = TitleKeyPolicy::compare(a.title, b.title)) return c;
+        return IsbnKeyPolicy::compare(a.isbn, b.isbn);
+    }
+    static int compare(const Key& a, const Probe& b) {
+        int c = TitleKeyPolicy::compare(a.title, b);
+        return c != 0 ? c : 1;
+    }
+    static int compare(const Probe& a, const Key& b) {
+        int c = TitleKeyPolicy::compare(a, b.title);
+        return c != 0 ? c : -1;
+    }
+    static bool matches(const Key& key, const Probe& probe) { return TitleKeyPolicy::matches(key.title, probe); }
+
+    static void memory(const Key& key, MemoryUsage& usage) {
+        TitleKeyPolicy::memory(key.title, usage);
+        IsbnKeyPolicy::memory(key.isbn, usage);
+    }
+};
+
+// --- Ordered index policies ---
+// Interface: insert(key, value, replace) stores the entry, or for an existing
+// key overwrites it only if replace(existingValue) is true; find(probe) the
+// first entry not below the probe, if the probe matches it; erase(key, value)
+// only if the entry still holds `value`; first(), seek(probe)
+// and seekRank(rank) return a Cursor { valid(), record(), next() };
+// compact(budget) rebuilds the index densely, in steps while it returns true;
+// memory(usage) adds the index's own bytes.
+
+template <typename KeyPolicy, typename Value>
+class MapIndex {
+private:
+    using Key = typename KeyPolicy::Key;
+    using Probe = typename KeyPolicy::Probe;
+
+    struct Less {
+        using is_transparent = void;
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const { return KeyPolicy::compare(a, b) < 0; }
+    };
+
+    using Map = std::map<Key, Value, Less>;
+    Map entries;
+
+    // compact() copies entries in key order into `fresh`, whose nodes then sit
+    // together in memory. Entries up to `copiedKey` are already copied, so
+    // changes in that range are applied to both maps; the rest is copied later.
+    Map fresh;
+    bool rebuilding = false;
+    bool copiedAny = false;
+    Key copiedKey{};
+    Value copiedValue{}; // Keeps the record a view key points into alive
+
+    // After the swap `fresh` holds the old entries until they are freed
+    bool release(size_t& budget) {
+        for (; !fresh.empty() && budget > 0; --budget) fresh.erase(fresh.begin());
+        return !fresh.empty();
+    }
+
+    bool copied(const Key& key) const {
+        return rebuilding && copiedAny && KeyPolicy::compare(key, copiedKey) <= 0;
+    }
+
+    template <typename Replace>
+    static bool put(Map& map, const Key& key, const Value& value, Replace replace) {
+        auto it = map.lower_bound(key);
+        if (it != map.end() && KeyPolicy::compare(it->first, key) == 0) {
+            if (!replace(it->second)) return false;
+            // The old key may point into the old record: re-key the node itself
+            auto node = map.extract(it);
+            node.key() = key;
+            node.mapped() = value;
+            map.insert(std::move(node));
+            return true;
+        }
+        map.emplace_hint(it, key, value);
+        return true;
+    }
+
+    static bool remove(Map& map, const Key& key, const Value& value) {
+        auto it = map.find(key);
+        if (it == map.end() || it->second != value) return false;
+        map.erase(it);
+        return true;
+    }
+
+    static void nodeMemory(const Map& map, MemoryUsage& usage) {
+        for (const auto& entry : map) {
+            usage.allocation(sizeof(entry), MAP_NODE_HEADER + sizeof(entry));
+            KeyPolicy::memory(entry.first, usage);
+        }
+    }
+
+public:
+    static constexpr const char* name = "map";
+
+    class Cursor {
+    private:
+        typename Map::const_iterator it;
+        typename Map::const_iterator end;
+
+    public:
+        Cursor(typename Map::const_iterator it, typename Map::const_iterator end) : it(it), end(end) {}
+
+        bool valid() const { return it != end; }
+        const Value& record() const { return it->second; }
+        void next() { ++it; }
+    };
+
+    template <typename Replace>
+    bool insert(const Key& key, const Value& value, Replace replace) {
+        if (!put(entries, key, value, replace)) return false;
+        if (copied(key)) put(fresh, key, value, [](const Value&) { return true; });
+        return true;
+    }
+
+    const Value* find(const Probe& probe) const {
+        auto it = entries.lower_bound(probe);
+        return it != entries.end() && KeyPolicy::matches(it->first, probe) ? &it->second : nullptr;
+    }
+
+    bool erase(const Key& key, const Value& value) {
+        if (!remove(entries, key, value)) return false;
+        if (copied(key)) remove(fresh, key, value);
+        return true;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // Copies at most `budget` entries per call, swaps the copy in, then frees
+    // the replaced map the same way
+    bool compact(size_t& budget) {
+        if (!rebuilding && !fresh.empty()) return release(budget);
+        auto it = entries.begin();
+        if (!rebuilding) {
+            rebuilding = true;
+            copiedAny = false;
+        } else if (copiedAny) {
+            it = entries.upper_bound(copiedKey);
+        }
+        for (; it != entries.end() && budget > 0; ++it, --budget) {
+            fresh.emplace_hint(fresh.end(), it->first, it->second);
+            copiedKey = it->first;
+            copiedValue = it->second;
+            copiedAny = true;
+        }
+        if (it != entries.end()) return true;
+
+        entries.swap(fresh);
+        rebuilding = copiedAny = false;
+        copiedKey = Key();
+        copiedValue = Value();
+        return release(budget);
+    }
+
+    void memory(MemoryUsage& usage) const {
+        nodeMemory(entries, usage);
+        MemoryUsage copy; // A half-built copy, or the map it replaced, is pure overhead
+        nodeMemory(fresh, copy);
+        usage.overhead += copy.total();
+    }
+
+    Cursor first() const { return Cursor(entries.begin(), entries.end()); }
+    Cursor seek(const Probe& probe) const { return Cursor(entries.lower_bound(probe), entries.end()); }
+
+    // std::map keeps no ranks, so this walks from the nearer end:
+    // min(rank, size - rank) entries
+    Cursor seekRank(size_t rank) const {
+        rank = std::min(rank, entries.size());
+        auto it = entries.begin();
+        if (rank <= entries.size() / 2) {
+            std::advance(it, rank);
+        } else {
+            it = entries.end();
+            std::advance(it, -static_cast<std::ptrdiff_t>(entries.size() - rank));
+        }
+        return Cursor(it, entries.end());
+    }
+};
+
+// The BST from library.cpp, made generic and iterative: parent links let
+// cursors walk in order without a stack, subtree sizes give O(h) rank seek.
+// It is not rebalanced on insert, so keys inserted in sorted order degrade it
+// to a list until compact() rebuilds it balanced.
+template <typename KeyPolicy, typename Value>
+class BstIndex {
+private:
+    using Key = typename KeyPolicy::Key;
+    using Probe = typename KeyPolicy::Probe;
+
+    struct Node {
+        Key key;
+        Value value;
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+        Node* parent = nullptr;
+        size_t size = 1;
+
+        Node(const Key& key, const Value& value) : key(key), value(value) {}
+    };
+
+    std::unique_ptr<Node> root;
+
+    // compact() copies entries in key order into `building`, allocating its
+    // nodes one after another so they end up together in memory. `next` is
+    // the next node of `root` to copy; changes at or below `copiedKey` are
+    // applied to both trees. The old tree then goes to `retired` and is freed
+    // a bounded number of nodes per step.
+    enum class Rebuild { Idle, Copy, Release };
+    Rebuild stage = Rebuild::Idle;
+    std::unique_ptr<Node> building;
+    std::unique_ptr<Node> retired;
+    size_t retiredCount = 0;
+    const Node* next = nullptr;
+    bool copiedAny = false;
+    Key copiedKey{};
+    Value copiedValue{}; // Keeps the record a view key points into alive
+
+    static size_t subtreeSize(const std::unique_ptr<Node>& node) {
+        return node ? node->size : 0;
+    }
+
+    static const Node* leftmost(const Node* node) {
+        while (node && node->left) node = node->left.get();
+        return node;
+    }
+
+    static const Node* successor(const Node* node) {
+        if (node->right) return leftmost(node->right.get());
+        const Node* child = node;
+        node = node->parent;
+        while (node && child == node->right.get()) {
+            child = node;
+            node = node->parent;
+        }
+        return node;
+    }
+
+    template <typename K>
+    static Node* findNode(const std::unique_ptr<Node>& tree, const K& key) {
+        Node* node = tree.get();
+        while (node) {
+            int c = KeyPolicy::compare(key, node->key);
+            if (c == 0) return node;
+            node = c < 0 ? node->left.get() : node->right.get();
+        }
+        return nullptr;
+    }
+
+    const Node* lowerBound(const Probe& probe) const {
+        const Node* node = root.get();
+        const Node* candidate = nullptr;
+        while (node) {
+            if (KeyPolicy::compare(node->key, probe) < 0) {
+                node = node->right.get();
+            } else {
+                candidate = node;
+                node = node->left.get();
+            }
+        }
+        return candidate;
+    }
+
+    bool copied(const Key& key) const {
+        return stage == Rebuild::Copy && copiedAny && KeyPolicy::compare(key, copiedKey) <= 0;
+    }
+
+    // Stores the entry; returns the node it created, or null for an existing key
+    template <typename Replace>
+    static const Node* put(std::unique_ptr<Node>& tree, const Key& key, const Value& value, Replace replace,
+                           bool& stored) {
+        std::unique_ptr<Node>* slot = &tree;
+        Node* parent = nullptr;
+        while (*slot) {
+            Node* node = slot->get();
+            int c = KeyPolicy::compare(key, node->key);
+            if (c == 0) {
+                stored = replace(node->value);
+                if (stored) {
+                    node->key = key;
+                    node->value = value;
+                }
+                return nullptr;
+            }
+            parent = node;
+            slot = c < 0 ? &node->left : &node->right;
+        }
+        slot->reset(new Node(key, value));
+        (*slot)->parent = parent;
+        for (Node* p = parent; p; p = p->parent) ++p->size;
+        stored = true;
+        return slot->get();
+    }
+
+    // Unlinks the entry if it still holds `value`. `keep`, if given, points
+    // at a node pointer that must stay on the same entry or its successor.
+    static bool remove(std::unique_ptr<Node>& tree, const Key& key, const Value& value, const Node** keep) {
+        Node* node = findNode(tree, key);
+        if (!node || node->value != value) return false;
+        if (node->left && node->right) {
+            // Two children: take over the in-order successor's entry, unlink the successor
+            Node* successor = node->right.get();
+            while (successor->left) successor = successor->left.get();
+            node->key = std::move(successor->key);
+            node->value = std::move(successor->value);
+            if (keep && *keep == successor) *keep = node;
+            node = successor;
+        } else if (keep && *keep == node) {
+            *keep = BstIndex::successor(node);
+        }
+        Node* parent = node->parent;
+        std::unique_ptr<Node>& slot = !parent ? tree : (parent->left.get() == node ? parent->left : parent->right);
+        std::unique_ptr<Node> detached = std::move(slot);
+        slot = std::move(node->left ? node->left : node->right);
+        if (slot) slot->parent = parent;
+        for (Node* p = parent; p; p = p->parent) --p->size;
+        return true;
+    }
+
+    // Appends a node whose key is above every key in `tree`. This builds the
+    // tree bottom-up: the highest right-spine node whose right side has grown
+    // as large as its left becomes the new node's left subtree, so a tree
+    // built only by appends is balanced.
+    static void append(std::unique_ptr<Node>& tree, std::unique_ptr<Node> node) {
+        std::unique_ptr<Node>* slot = &tree;
+        Node* parent = nullptr;
+        while (*slot && (*slot)->size < 2 * subtreeSize((*slot)->left) + 1) {
+            ++(*slot)->size;
+            parent = slot->get();
+            slot = &(*slot)->right;
+        }
+        node->left = std::move(*slot);
+        if (node->left) node->left->parent = node.get();
+        node->size = subtreeSize(node->left) + 1;
+        node->parent = parent;
+        *slot = std::move(node);
+    }
+
+    // Frees at most `budget` steps of a detached tree with O(1) extra memory:
+    // left children are rotated up, and nodes without one are freed. Parent
+    // links and sizes are not kept. Returns true while nodes remain.
+    static bool release(std::unique_ptr<Node>& tree, size_t& budget, size_t& count) {
+        while (tree && budget > 0) {
+            --budget;
+            if (tree->left) {
+                std::unique_ptr<Node> left = std::move(tree->left);
+                tree->left = std::move(left->right);
+                left->right = std::move(tree);
+                tree = std::move(left);
+            } else {
+                tree = std::move(tree->right);
+                --count;
+            }
+        }
+        return tree != nullptr;
+    }
+
+    // Iterative, so a degenerate tree cannot overflow the stack
+    void clear() {
+        size_t unlimited = SIZE_MAX;
+        size_t count = 0;
+        release(root, unlimited, count);
+        release(building, unlimited, count);
+        release(retired, unlimited, retiredCount);
+        stage = Rebuild::Idle;
+    }
+
+public:
+    static constexpr const char* name = "bst";
+
+    // Holds a single node pointer; any insert, erase or compact() step invalidates it
+    class Cursor {
+    private:
+        const Node* node;
+
+    public:
+        explicit Cursor(const Node* node = nullptr) : node(node) {}
+
+        bool valid() const { return node != nullptr; }
+        const Value& record() const { return node->value; }
+        void next() { node = successor(node); }
+    };
+
+    BstIndex() = default;
+    BstIndex(const BstIndex&) = delete;
+    BstIndex& operator=(const BstIndex&) = delete;
+    BstIndex(BstIndex&&) = default;
+    BstIndex& operator=(BstIndex&& other) {
+        clear();
+        root = std::move(other.root);
+        building = std::move(other.building);
+        retired = std::move(other.retired);
+        retiredCount = other.retiredCount;
+        stage = other.stage;
+        next = other.next;
+        copiedAny = other.copiedAny;
+        copiedKey = std::move(other.copiedKey);
+        copiedValue = std::move(other.copiedValue);
+        other.stage = Rebuild::Idle;
+        return *this;
+    }
+
+    ~BstIndex() {
+        clear();
+    }
+
+    template <typename Replace>
+    bool insert(const Key& key, const Value& value, Replace replace) {
+        bool stored = false;
+        const Node* created = put(root, key, value, replace, stored);
+        if (!stored) return false;
+        if (copied(key)) {
+            put(building, key, value, [](const Value&) { return true; }, stored);
+        } else if (created && stage == Rebuild::Copy && (!next || KeyPolicy::compare(key, next->key) < 0)) {
+            next = created; // Lands between the copied range and `next`
+        }
+        return true;
+    }
+
+    const Value* find(const Probe& probe) const {
+        const Node* node = lowerBound(probe);
+        return node && KeyPolicy::matches(node->key, probe) ? &node->value : nullptr;
+    }
+
+    bool erase(const Key& key, const Value& value) {
+        bool wasCopied = copied(key);
+        if (!remove(root, key, value, stage == Rebuild::Copy ? &next : nullptr)) return false;
+        if (wasCopied) remove(building, key, value, nullptr);
+        return true;
+    }
+
+    size_t size() const { return subtreeSize(root); }
+
+    // Copies at most `budget` entries per call into a balanced tree of freshly
+    // allocated nodes, swaps it in, then frees the old nodes the same way
+    bool compact(size_t& budget) {
+        if (stage == Rebuild::Idle) {
+            stage = Rebuild::Copy;
+            next = leftmost(root.get());
+            copiedAny = false;
+        }
+        if (stage == Rebuild::Copy) {
+            for (; next && budget > 0; --budget) {
+                append(building, std::unique_ptr<Node>(new Node(next->key, next->value)));
+                copiedKey = next->key;
+                copiedValue = next->value;
+                copiedAny = true;
+                next = successor(next);
+            }
+            if (next) return true;
+            retiredCount = size();
+            retired = std::move(root);
+            root = std::move(building);
+            stage = Rebuild::Release;
+            copiedAny = false;
+            copiedKey = Key();
+            copiedValue = Value();
+        }
+        if (release(retired, budget, retiredCount)) return true;
+        stage = Rebuild::Idle;
+        return false;
+    }
+
+    // A half-built copy and not yet freed nodes count as overhead
+    void memory(MemoryUsage& usage) const {
+        for (const Node* node = leftmost(root.get()); node; node = successor(node)) {
+            usage.allocation(sizeof(Key) + sizeof(Value), sizeof(Node));
+            KeyPolicy::memory(node->key, usage);
+        }
+        usage.overhead += (subtreeSize(building) + retiredCount) * allocationSize(sizeof(Node));
+    }
+
+    Cursor first() const { return Cursor(leftmost(root.get())); }
+
+    // First entry whose key is not less than `probe`, in O(h)
+    Cursor seek(const Probe& probe) const { return Cursor(lowerBound(probe)); }
+
+    // Entry at in-order position `rank`, in O(h)
+    Cursor seekRank(size_t rank) const {
+        const Node* node = root.get();
+        while (node) {
+            size_t leftSize = subtreeSize(node->left);
+            if (rank < leftSize) {
+                node = node->left.get();
+            } else if (rank == leftSize) {
+                break;
+            } else {
+                rank -= leftSize + 1;
+                node = node->right.get();
+            }
+        }
+        return Cursor(node);
+    }
+};
+
+// --- Genre storage policies ---
+// Each genre keeps its records in insertion order. Removed records stay as
+// tombstones until compact(budget) sweeps them out a bounded step at a time,
+// taking what it uses from `budget`; the bucket being swept has a gap of null
+// entries between the write and read positions, which visits skip.
+
+namespace detail {
+
+// Sweeps one bucket from (read, write); returns true once it reached the end
+template <typename Record>
+bool sweepBucket(std::vector<std::shared_ptr<Record>>& bucket, size_t& read, size_t& write,
+                 size_t& budget, size_t& stale) {
+    while (budget > 0 && read < bucket.size()) {
+        --budget;
+        std::shared_ptr<Record>& record = bucket[read++];
+        if (RecordTraits<Record>::deleted(*record)) {
+            record.reset();
+            --stale;
+            continue;
+        }
+        if (write != read - 1) bucket[write] = std::move(record);
+        ++write;
+    }
+    if (read < bucket.size()) return false;
+    bucket.resize(write);
+    read = write = 0;
+    return true;
+}
+
+template <typename Record, typename Visitor>
+void visitLive(const std::vector<std::shared_ptr<Record>>& bucket, Visitor& visit) {
+    for (const auto& record : bucket) {
+        if (record && !RecordTraits<Record>::deleted(*record)) visit(record);
+    }
+}
+
+// Live entries are data, tombstones and spare capacity overhead; records
+// that are only still held here are passed to `tombstone`
+template <typename Record, typename Tombstone>
+void bucketMemory(const std::vector<std::shared_ptr<Record>>& bucket, MemoryUsage& usage, Tombstone& tombstone) {
+    size_t live = 0;
+    for (const auto& record : bucket) {
+        if (!record) continue;
+        if (RecordTraits<Record>::deleted(*record)) {
+            tombstone(*record);
+        } else {
+            ++live;
+        }
+    }
+    usage.allocation(live * sizeof(std::shared_ptr<Record>), bucket.capacity() * sizeof(std::shared_ptr<Record>));
+}
+
+// Reallocates a bucket at its exact size; copies rather than shrink_to_fit,
+// which is only a request
+template <typename T>
+void shrink(std::vector<T>& bucket) {
+    if (bucket.capacity() == bucket.size()) return;
+    std::vector<T>(std::make_move_iterator(bucket.begin()), std::make_move_iterator(bucket.end())).swap(bucket);
+}
+
+template <typename Record>
+bool anyLive(const std::vector<std::shared_ptr<Record>>& bucket) {
+    for (const auto& record : bucket) {
+        if (record && !RecordTraits<Record>::deleted(*record)) return true;
+    }
+    return false;
+}
+
+} // namespace detail
+
+template <typename Record>
+class VectorBuckets {
+private:
+    using Ptr = std::shared_ptr<Record>;
+    using Bucket = std::vector<Ptr>;
+
+    std::vector<std::pair<std::string, Bucket>> buckets;
+    size_t stale = 0;
+    size_t sweepIndex = 0;
+    size_t sweepRead = 0;
+    size_t sweepWrite = 0;
+    size_t shrinkIndex = 0;
+
+    const Bucket* find(std::string_view genre) const {
+        for (const auto& pair : buckets) {
+            if (pair.first == genre) return &pair.second;
+        }
+        return nullptr;
+    }
+
+public:
+    static constexpr const char* name = "vector";
+
+    void add(const std::string& genre, const Ptr& record) {
+        for (auto& pair : buckets) {
+            if (pair.first == genre) {
+                pair.second.push_back(record);
+                return;
+            }
+        }
+        buckets.emplace_back(genre, Bucket{record});
+    }
+
+    // Live records of `genre` in insertion order; false if the genre never existed
+    template <typename Visitor>
+    bool visit(std::string_view genre, Visitor visit) const {
+        const Bucket* bucket = find(genre);
+        if (!bucket) return false;
+        detail::visitLive(*bucket, visit);
+        return true;
+    }
+
+    // visit(name, hasLiveRecords) per genre, in first-seen order
+    template <typename Visitor>
+    void visitGenres(Visitor visit) const {
+        for (const auto& pair : buckets) visit(pair.first, detail::anyLive(pair.second));
+    }
+
+    void noteTombstone() { ++stale; }
+    size_t tombstones() const { return stale; }
+
+    // Visits at most `budget` entries, charging one more per finished bucket
+    // so runs of empty buckets stay bounded; true while tombstones remain
+    bool compact(size_t& budget) {
+        while (stale > 0 && budget > 0) {
+            if (sweepIndex >= buckets.size()) sweepIndex = 0;
+            if (detail::sweepBucket(buckets[sweepIndex].second, sweepRead, sweepWrite, budget, stale)) {
+                ++sweepIndex;
+                if (budget > 0) --budget;
+            }
+        }
+        return stale > 0;
+    }
+
+    // Drops spare capacity, one bucket per unit of budget; call once the
+    // sweep is done. True while buckets remain.
+    bool shrink(size_t& budget) {
+        while (budget > 0 && shrinkIndex < buckets.size()) {
+            --budget;
+            detail::shrink(buckets[shrinkIndex++].second);
+        }
+        if (shrinkIndex < buckets.size()) return true;
+        detail::shrink(buckets);
+        shrinkIndex = 0;
+        return false;
+    }
+
+    template <typename Tombstone>
+    void memory(MemoryUsage& usage, Tombstone tombstone) const {
+        usage.allocation(buckets.size() * sizeof(buckets[0]), buckets.capacity() * sizeof(buckets[0]));
+        for (const auto& pair : buckets) {
+            usage.string(pair.first);
+            detail::bucketMemory(pair.second, usage, tombstone);
+        }
+    }
+};
+
+template <typename Record>
+class MapBuckets {
+private:
+    using Ptr = std::shared_ptr<Record>;
+    using Bucket = std::vector<Ptr>;
+    using Map = std::map<std::string, Bucket, std::less<>>;
+
+    Map buckets;
+    size_t stale = 0;
+    typename Map::iterator sweep; // Genres are never erased, so this stays valid
+    bool sweeping = false;
+    size_t sweepRead = 0;
+    size_t sweepWrite = 0;
+    typename Map::iterator shrinkAt;
+    bool shrinking = false;
+
+public:
+    static constexpr const char* name = "map";
+
+    void add(const std::string& genre, const Ptr& record) {
+        auto it = buckets.lower_bound(genre);
+        if (it == buckets.end() || it->first != genre) it = buckets.emplace_hint(it, genre, Bucket());
+        it->second.push_back(record);
+    }
+
+    template <typename Visitor>
+    bool visit(std::string_view genre, Visitor visit) const {
+        auto it = buckets.find(genre);
+        if (it == buckets.end()) return false;
+        detail::visitLive(it->second, visit);
+        return true;
+    }
+
+    // visit(name, hasLiveRecords) per genre, in sorted order
+    template <typename Visitor>
+    void visitGenres(Visitor visit) const {
+        for (const auto& pair : buckets) visit(pair.first, detail::anyLive(pair.second));
+    }
+
+    void noteTombstone() { ++stale; }
+    size_t tombstones() const { return stale; }
+
+    bool compact(size_t& budget) {
+        while (stale > 0 && budget > 0) {
+            if (!sweeping || sweep == buckets.end()) {
+                sweep = buckets.begin();
+                sweeping = true;
+            }
+            if (detail::sweepBucket(sweep->second, sweepRead, sweepWrite, budget, stale)) {
+                ++sweep;
+                if (budget > 0) --budget;
+            }
+        }
+        return stale > 0;
+    }
+
+    bool shrink(size_t& budget) {
+        if (!shrinking) {
+            shrinkAt = buckets.begin();
+            shrinking = true;
+        }
+        for (; budget > 0 && shrinkAt != buckets.end(); ++shrinkAt) {
+            --budget;
+            detail::shrink(shrinkAt->second);
+        }
+        shrinking = shrinkAt != buckets.end();
+        return shrinking;
+    }
+
+    template <typename Tombstone>
+    void memory(MemoryUsage& usage, Tombstone tombstone) const {
+        for (const auto& pair : buckets) {
+            usage.allocation(sizeof(pair), MAP_NODE_HEADER + sizeof(pair));
+            usage.string(pair.first);
+            detail::bucketMemory(pair.second, usage, tombstone);
+        }
+    }
+};
+
+// --- Concurrency policies ---
+
+struct SingleThreaded {
+    static constexpr const char* name = "single";
+
+    struct ReadGuard {
+        explicit ReadGuard(SingleThreaded&) {}
+    };
+    using WriteGuard = ReadGuard;
+};
+
+// Readers share, writers are exclusive. Cursors are not covered: hold
+// lockShared() yourself while walking one.
+struct SharedLock {
+    static constexpr const char* name = "shared";
+
+    std::shared_mutex mutex;
+
+    struct ReadGuard {
+        std::shared_lock<std::shared_mutex> lock;
+        explicit ReadGuard(SharedLock& sync) : lock(sync.mutex) {}
+    };
+
+    struct WriteGuard {
+        std::unique_lock<std::shared_mutex> lock;
+        explicit WriteGuard(SharedLock& sync) : lock(sync.mutex) {}
+    };
+};
+
+// --- Engine ---
+
+// A cursor over either of the engine's indexes, whose key types differ
+template <typename First, typename Second>
+class EitherCursor {
+private:
+    std::variant<First, Second> cursor;
+
+public:
+    EitherCursor(const First& first) : cursor(std::in_place_index<0>, first) {}
+    EitherCursor(const Second& second) : cursor(std::in_place_index<1>, second) {}
+
+    bool valid() const {
+        return cursor.index() == 0 ? std::get<0>(cursor).valid() : std::get<1>(cursor).valid();
+    }
+    decltype(auto) record() const {
+        return cursor.index() == 0 ? std::get<0>(cursor).record() : std::get<1>(cursor).record();
+    }
+    void next() {
+        if (cursor.index() == 0) {
+            std::get<0>(cursor).next();
+        } else {
+            std::get<1>(cursor).next();
+        }
+    }
+};
+
+// TitleKeyPolicy defaults to KeyPolicy; CollatedKey is meant for titles only
+template <typename Record,
+          typename KeyPolicy = ViewKey,
+          template <typename, typename> class OrderedIndex = MapIndex,
+          template <typename> class GenreStorage = MapBuckets,
+          typename Concurrency = SingleThreaded,
+          typename TitleKeyPolicy = KeyPolicy>
+class Engine {
+public:
+    using Ptr = std::shared_ptr<Record>;
+    using Traits = RecordTraits<Record>;
+    using TitleKey = TitleEntryKey<TitleKeyPolicy, KeyPolicy>;
+    using Index = OrderedIndex<KeyPolicy, Ptr>;
+    using TitleIndex = OrderedIndex<TitleKey, Ptr>;
+    using ReadGuard = typename Concurrency::ReadGuard;
+    using WriteGuard = typename Concurrency::WriteGuard;
+
+private:
+    Index byISBN;
+    TitleIndex byTitle;
+    GenreStorage<Record> genres;
+    mutable Concurrency sync;
+
+    // Stages of a rebuild started by rebuild(); each runs in bounded steps
+    enum class Rebuild { Idle, Buckets, TitleIndex, IsbnIndex };
+    Rebuild stage = Rebuild::Idle;
+
+    // Bumped by every change that can move or free an index entry
+    uint64_t generation = 0;
+
+    template <typename AnyIndex, typename Visitor>
+    static void visitIndex(const AnyIndex& index, Visitor& visit) {
+        for (auto cursor = index.first(); cursor.valid(); cursor.next()) visit(cursor.record());
+    }
+
+public:
+    // A cursor over either index. It reads as exhausted (valid() false, stale()
+    // true) once the engine has changed since it was made: an insert, a remove
+    // or an index compaction step may have moved or freed its entry. Continue
+    // with seek() from the last key seen.
+    class Cursor {
+    private:
+        EitherCursor<typename Index::Cursor, typename TitleIndex::Cursor> cursor;
+        const uint64_t* generation;
+        uint64_t seen;
+
+    public:
+        template <typename IndexCursor>
+        Cursor(const IndexCursor& cursor, const uint64_t& generation)
+            : cursor(cursor), generation(&generation), seen(generation) {}
+
+        bool valid() const { return !stale() && cursor.valid(); }
+        bool stale() const { return *generation != seen; }
+        decltype(auto) record() const { return cursor.record(); }
+        void next() { cursor.next(); }
+    };
+
+    // "owned/map/map/single", or "view+collated/..." with a separate title key:
+    // the configuration, for benchmark output
+    static std::string configuration() {
+        std::string keys = KeyPolicy::name;
+        if (!std::is_same<KeyPolicy, TitleKeyPolicy>::value) keys = keys + "+" + TitleKeyPolicy::name;
+        return keys + "/" + Index::name + "/" + GenreStorage<Record>::name + "/" + Concurrency::name;
+    }
+
+    // Stores a record unless its ISBN is taken
+    bool insert(const Ptr& record) {
+        WriteGuard guard(sync);
+        const Record& r = *record;
+        if (!byISBN.insert(KeyPolicy::make(Traits::isbn(r)), record, [](const Ptr&) { return false; })) {
+            return false;
+        }
+        ++generation;
+        byTitle.insert(TitleKey::make(Traits::title(r), Traits::isbn(r)), record, [](const Ptr&) { return false; });
+        genres.add(Traits::genre(r), record);
+        return true;
+    }
+
+    // Tombstones the record and drops it from both indexes in O(log n); its
+    // genre bucket entry is swept out later by compact()
+    void remove(const Ptr& record) {
+        WriteGuard guard(sync);
+        Traits::markDeleted(*record);
+        ++generation;
+        byISBN.erase(KeyPolicy::make(Traits::isbn(*record)), record);
+        byTitle.erase(TitleKey::make(Traits::title(*record), Traits::isbn(*record)), record);
+        genres.noteTombstone();
+    }
+
+    Ptr findByISBN(std::string_view isbn) const {
+        ReadGuard guard(sync);
+        const Ptr* found = byISBN.find(KeyPolicy::probe(isbn));
+        return found ? *found : nullptr;
+    }
+
+    // Of the live records whose title matches (with CollatedKey: normalises
+    // alike), the first in title index order
+    Ptr findByTitle(std::string_view title) const {
+        ReadGuard guard(sync);
+        const Ptr* found = byTitle.find(TitleKey::probe(title));
+        return found ? *found : nullptr;
+    }
+
+    // Live records of a genre in insertion order; false if the genre is unknown
+    template <typename Visitor>
+    bool visitGenre(std::string_view genre, Visitor visit) const {
+        ReadGuard guard(sync);
+        return genres.visit(genre, visit);
+    }
+
+    template <typename Visitor>
+    void visitGenres(Visitor visit) const {
+        ReadGuard guard(sync);
+        genres.visitGenres(visit);
+    }
+
+    // Every live record in title or ISBN order
+    template <typename Visitor>
+    void visitAll(bool titleOrder, Visitor visit) const {
+        ReadGuard guard(sync);
+        if (titleOrder) {
+            visitIndex(byTitle, visit);
+        } else {
+            visitIndex(byISBN, visit);
+        }
+    }
+
+    // Cursors over the ordered indexes. Any insert, remove or compact() step
+    // that reaches the indexes makes them stale (see Cursor), and so can a
+    // front end's read if it drives compaction. seekRank() is O(h) on
+    // BstIndex (O(n) while it is degenerate) but walks up to size() / 2
+    // entries on MapIndex; page forward with visitPage() or seek() instead.
+    Cursor first(bool titleOrder) const {
+        return titleOrder ? Cursor(byTitle.first(), generation) : Cursor(byISBN.first(), generation);
+    }
+    Cursor seek(std::string_view key, bool titleOrder) const {
+        return titleOrder ? Cursor(byTitle.seek(TitleKey::probe(key)), generation)
+                          : Cursor(byISBN.seek(KeyPolicy::probe(key)), generation);
+    }
+    Cursor seekRank(size_t rank, bool titleOrder) const {
+        return titleOrder ? Cursor(byTitle.seekRank(rank), generation) : Cursor(byISBN.seekRank(rank), generation);
+    }
+
+    // Visits up to `pageSize` records from the cursor and leaves it on the
+    // first record of the next page; returns how many were visited
+    template <typename Visitor>
+    static size_t visitPage(Cursor& cursor, size_t pageSize, Visitor visit) {
+        size_t visited = 0;
+        for (; cursor.valid() && visited < pageSize; cursor.next(), ++visited) visit(*cursor.record());
+        return visited;
+    }
+
+    // Live records (the ISBN index holds exactly those)
+    size_t size() const {
+        ReadGuard guard(sync);
+        return byISBN.size();
+    }
+
+    // One step of tombstone sweeping, then of the rebuild if one was requested,
+    // sharing a single `budget`; true while work remains
+    bool compact(size_t budget = 256) {
+        WriteGuard guard(sync);
+        if (genres.compact(budget)) return true;
+        switch (stage) {
+            case Rebuild::Idle:
+                return false;
+            case Rebuild::Buckets:
+                if (genres.shrink(budget)) return true;
+                stage = Rebuild::TitleIndex;
+                [[fallthrough]];
+            case Rebuild::TitleIndex:
+                if (budget == 0) return true;
+                ++generation;
+                if (byTitle.compact(budget)) return true;
+                stage = Rebuild::IsbnIndex;
+                [[fallthrough]];
+            case Rebuild::IsbnIndex:
+                if (budget == 0) return true;
+                ++generation;
+                if (byISBN.compact(budget)) return true;
+                stage = Rebuild::Idle;
+        }
+        return false;
+    }
+
+    // Asks the following compact() steps to also drop bucket slack and rebuild
+    // both indexes densely. Lookups and updates keep working in between.
+    void rebuild() {
+        WriteGuard guard(sync);
+        if (stage == Rebuild::Idle) stage = Rebuild::Buckets;
+    }
+
+    bool rebuilding() const {
+        ReadGuard guard(sync);
+        return stage != Rebuild::Idle;
+    }
+
+    struct Memory {
+        MemoryUsage records;
+        MemoryUsage isbnIndex;
+        MemoryUsage titleIndex;
+        MemoryUsage genres;
+    };
+
+    // Walks every structure once, O(n)
+    Memory memory() const {
+        ReadGuard guard(sync);
+        Memory usage;
+        auto record = [](const Record& r, MemoryUsage& into) {
+            into.allocation(sizeof(Record), CONTROL_BLOCK + sizeof(Record));
+            Traits::memory(r, into);
+        };
+        for (auto cursor = byISBN.first(); cursor.valid(); cursor.next()) {
+            record(*cursor.record(), usage.records);
+        }
+        // Removed records still held by a bucket entry are waste until the sweep
+        MemoryUsage removed;
+        genres.memory(usage.genres, [&](const Record& r) { record(r, removed); });
+        usage.records.overhead += removed.total();
+        byISBN.memory(usage.isbnIndex);
+        byTitle.memory(usage.titleIndex);
+        return usage;
+    }
+
+    Concurrency& lock() const { return sync; }
+};
+
+} // namespace catalog
+
+#endif
@@ -4,9 +4,20 @@
 #include <queue>
 #include <stack>
 #include <set>
-#include <list>
 #include <algorithm>
 #include <memory>
+#include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "catalog_engine.hpp"
+#include "metrics.hpp"
 
 // Book class representing individual book
 class Book {
@@ -17,94 +28,166 @@ public:
     std::string genre;
     bool isAvailable;
     int borrowCount;
+    bool isDeleted; // Tombstone, set by removeBook/updateBook until compaction
 
     Book(const std::string& isbn, const std::string& title, 
          const std::string& author, const std::string& genre)
         : isbn(isbn), title(title), author(author), genre(genre), 
-          isAvailable(true), borrowCount(0) {}
+          isAvailable(true), borrowCount(0), isDeleted(false) {}
 
     void display() const {
         std::cout << "ISBN: " << isbn << ", Title: " << title 
                   << ", Author: " << author << ", Genre: " << genre 
-                  << ", Available: " << (isAvailable ? "Yes" : "No") << std::endl;
+                  << ", Available: " << (isAvailable ? "Yes" : "No") << '\n';
     }
 };
 
-// BST Node for organizing books by title or ISBN
-class BSTNode {
-public:
-    std::shared_ptr<Book> book;
-    std::shared_ptr<BSTNode> left;
-    std::shared_ptr<BSTNode> right;
-
-    BSTNode(std::shared_ptr<Book> b) : book(b), left(nullptr), right(nullptr) {}
+// Output formats for book listings
+enum class OutputFormat {
+    Human,    // Same lines as Book::display
+    TSV,      // isbn, title, author, genre, available, borrowCount
+    JSONLines // One JSON object per book
 };
 
-// Binary Search Tree for fast book searching
-class BST {
+// Formats books into a reusable buffer and writes it out in large blocks
+class BookRenderer {
 private:
-    std::shared_ptr<BSTNode> root;
+    std::ostream& out;
+    std::string buffer;
+    size_t flushThreshold;
 
-    std::shared_ptr<BSTNode> insert(std::shared_ptr<BSTNode> node, 
-                                   std::shared_ptr<Book> book, 
-                                   bool byTitle = true) {
-        if (!node) {
-            return std::make_shared<BSTNode>(book);
+    void appendField(const std::string& text, OutputFormat format) {
+        if (format == OutputFormat::Human) {
+            buffer += text;
+            return;
         }
-
-        std::string key = byTitle ? book->title : book->isbn;
-        std::string nodeKey = byTitle ? node->book->title : node->book->isbn;
-
-        if (key < nodeKey) {
-            node->left = insert(node->left, book, byTitle);
-        } else if (key > nodeKey) {
-            node->right = insert(node->right, book, byTitle);
+        for (char c : text) {
+            switch (c) {
+                case '\t': buffer += "\\t"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\\': buffer += "\\\\"; break;
+                case '"':
+                    buffer += format == OutputFormat::JSONLines ? "\\\"" : "\"";
+                    break;
+                default:
+                    if (format == OutputFormat::JSONLines && 
+                        static_cast<unsigned char>(c) < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        buffer += "\\u00";
+                        buffer += hex[(c >> 4) & 0xF];
+                        buffer += hex[c & 0xF];
+                    } else {
+                        buffer += c;
+                    }
+            }
         }
-        return node;
     }
 
-    std::shared_ptr<Book> search(std::shared_ptr<BSTNode> node, 
-                                const std::string& key, 
-                                bool byTitle = true) {
-        if (!node) return nullptr;
+public:
+    OutputFormat format;
 
-        std::string nodeKey = byTitle ? node->book->title : node->book->isbn;
+    explicit BookRenderer(std::ostream& out = std::cout, 
+                          OutputFormat format = OutputFormat::Human, 
+                          size_t flushThreshold = 64 * 1024)
+        : out(out), flushThreshold(flushThreshold), format(format) {
+        buffer.reserve(flushThreshold + 1024);
+    }
 
-        if (key == nodeKey) {
-            return node->book;
-        } else if (key < nodeKey) {
-            return search(node->left, key, byTitle);
-        } else {
-            return search(node->right, key, byTitle);
-        }
+    ~BookRenderer() {
+        flush();
     }
 
-    void inorderTraversal(std::shared_ptr<BSTNode> node, 
-                         std::vector<std::shared_ptr<Book>>& books) {
-        if (node) {
-            inorderTraversal(node->left, books);
-            books.push_back(node->book);
-            inorderTraversal(node->right, books);
+    void render(const Book& book) {
+        switch (format) {
+            case OutputFormat::Human:
+                buffer += "ISBN: ";
+                appendField(book.isbn, format);
+                buffer += ", Title: ";
+                appendField(book.title, format);
+                buffer += ", Author: ";
+                appendField(book.author, format);
+                buffer += ", Genre: ";
+                appendField(book.genre, format);
+                buffer += book.isAvailable ? ", Available: Yes\n" : ", Available: No\n";
+                break;
+            case OutputFormat::TSV:
+                appendField(book.isbn, format);
+                buffer += '\t';
+                appendField(book.title, format);
+                buffer += '\t';
+                appendField(book.author, format);
+                buffer += '\t';
+                appendField(book.genre, format);
+                buffer += book.isAvailable ? "\t1\t" : "\t0\t";
+                buffer += std::to_string(book.borrowCount);
+                buffer += '\n';
+                break;
+            case OutputFormat::JSONLines:
+                buffer += "{\"isbn\":\"";
+                appendField(book.isbn, format);
+                buffer += "\",\"title\":\"";
+                appendField(book.title, format);
+                buffer += "\",\"author\":\"";
+                appendField(book.author, format);
+                buffer += "\",\"genre\":\"";
+                appendField(book.genre, format);
+                buffer += book.isAvailable ? "\",\"available\":true" : "\",\"available\":false";
+                buffer += ",\"borrowCount\":";
+                buffer += std::to_string(book.borrowCount);
+                buffer += "}\n";
+                break;
+        }
+        if (buffer.size() >= flushThreshold) {
+            flush();
         }
     }
 
-public:
-    BST() : root(nullptr) {}
+    // Free-form text (headers, notices); only emitted in Human format
+    void write(const std::string& text) {
+        if (format != OutputFormat::Human) return;
+        buffer += text;
+        if (buffer.size() >= flushThreshold) {
+            flush();
+        }
+    }
 
-    void insertBook(std::shared_ptr<Book> book, bool byTitle = true) {
-        root = insert(root, book, byTitle);
+    void writeLine(const std::string& text) {
+        write(text);
+        write("\n");
     }
 
-    std::shared_ptr<Book> searchBook(const std::string& key, bool byTitle = true) {
-        return search(root, key, byTitle);
+    void flush() {
+        if (buffer.empty()) return;
+        out.write(buffer.data(), buffer.size());
+        buffer.clear(); // Keeps the capacity for the next listing
     }
+};
 
-    std::vector<std::shared_ptr<Book>> getAllBooks() {
-        std::vector<std::shared_ptr<Book>> books;
-        inorderTraversal(root, books);
-        return books;
+// Field access for the catalog engine (catalog_engine.hpp)
+namespace catalog {
+template <>
+struct RecordTraits<Book> {
+    static const std::string& isbn(const Book& book) { return book.isbn; }
+    static const std::string& title(const Book& book) { return book.title; }
+    static const std::string& genre(const Book& book) { return book.genre; }
+    static bool deleted(const Book& book) { return book.isDeleted; }
+    static void markDeleted(Book& book) { book.isDeleted = true; }
+
+    static void memory(const Book& book, MemoryUsage& usage) {
+        usage.string(book.isbn);
+        usage.string(book.title);
+        usage.string(book.author);
+        usage.string(book.genre);
     }
 };
+}
+
+// Title and ISBN indexes are hand-written BSTs with rank seek, genres a vector
+// of buckets in first-seen order. Titles are ordered and matched by collation
+// key, ignoring case, accents and a leading article.
+using LibraryCatalog = catalog::Engine<Book, catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets,
+                                       catalog::SingleThreaded, catalog::CollatedKey>;
 
 // Borrow Request structure
 struct BorrowRequest {
@@ -116,21 +199,155 @@ struct BorrowRequest {
         : userID(uid), bookISBN(isbn), action(act) {}
 };
 
+// Fixed-size pool where each worker owns a deque: it runs its own newest task
+// and steals the oldest task of another worker when it runs dry. Tasks may
+// submit subtasks. The thread calling wait() works as worker 0.
+class WorkStealingPool {
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> pending{0}; // Submitted and not yet finished
+    std::atomic<size_t> queued{0};  // Submitted and not yet taken by a thread
+    std::atomic<bool> stopping{false};
+    std::mutex idleLock;
+    std::condition_variable idle; // Signalled on submit, when all work is done and on shutdown
+
+    inline static thread_local WorkStealingPool* currentPool = nullptr;
+    inline static thread_local size_t currentWorker = 0;
+
+    bool runOne(size_t self) {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> guard(queues[self]->lock);
+            if (!queues[self]->tasks.empty()) {
+                task = std::move(queues[self]->tasks.back());
+                queues[self]->tasks.pop_back();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        for (size_t i = 1; !task && i < queues.size(); ++i) {
+            WorkerQueue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        if (!task) return false;
+        task();
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> guard(idleLock);
+            idle.notify_all();
+        }
+        return true;
+    }
+
+    // Idle threads sleep until a task is queued or `done` holds. Every change
+    // to either is followed by a notify under idleLock, so none is missed and
+    // no thread polls.
+    template <typename Done>
+    void waitForWork(Done done) {
+        std::unique_lock<std::mutex> guard(idleLock);
+        idle.wait(guard, [&] { return queued.load(std::memory_order_acquire) > 0 || done(); });
+    }
+
+    void workerLoop(size_t self) {
+        currentPool = this;
+        currentWorker = self;
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (!runOne(self)) waitForWork([this] { return stopping.load(std::memory_order_acquire); });
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t threadCount) {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; ++i) {
+            queues.emplace_back(new WorkerQueue());
+        }
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> guard(idleLock);
+            idle.notify_all();
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    void submit(std::function<void()> task) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        queued.fetch_add(1, std::memory_order_relaxed);
+        size_t worker = currentPool == this ? currentWorker : 0;
+        {
+            std::lock_guard<std::mutex> guard(queues[worker]->lock);
+            queues[worker]->tasks.push_back(std::move(task));
+        }
+        if (!threads.empty()) {
+            std::lock_guard<std::mutex> guard(idleLock);
+            idle.notify_one();
+        }
+    }
+
+    // Run tasks on the calling thread until every submitted task has finished
+    void wait() {
+        WorkStealingPool* previousPool = currentPool;
+        size_t previousWorker = currentWorker;
+        currentPool = this;
+        currentWorker = 0;
+        while (pending.load(std::memory_order_acquire) > 0) {
+            if (!runOne(0)) waitForWork([this] { return pending.load(std::memory_order_acquire) == 0; });
+        }
+        currentPool = previousPool;
+        currentWorker = previousWorker;
+    }
+};
+
 // Graph for book recommendation system using adjacency list
 class RecommendationGraph {
 private:
-    // Adjacency list: book -> set of connected books
-    std::vector<std::pair<std::string, std::set<std::string>>> adjacencyList;
+    enum NodeState : char { Live, Removed, Sweeping, Free };
+
+    // Books are nodes with dense integer ids; edges and genre groups store ids
+    std::vector<std::string> isbnOf;             // id -> ISBN
+    std::vector<std::vector<int>> adjacency;     // id -> neighbours, sorted by ISBN
+    std::vector<NodeState> state;
+    std::map<std::string, int> idOf;             // Live ISBN -> id
+    std::vector<int> freeIds;                    // Swept ids ready for reuse
     // Genre-based grouping
-    std::vector<std::pair<std::string, std::vector<std::string>>> genreGroups;
+    std::vector<std::pair<std::string, std::vector<int>>> genreGroups;
 
-    int findBookIndex(const std::string& isbn) {
-        for (size_t i = 0; i < adjacencyList.size(); i++) {
-            if (adjacencyList[i].first == isbn) {
-                return i;
-            }
-        }
-        return -1;
+    // Removed books waiting for the next sweep, and the ones the current sweep drops
+    std::vector<int> removedBooks;
+    std::vector<int> sweepRemovals;
+    bool sweeping = false;
+    size_t sweepRead = 0;  // Next node to visit
+    size_t sweepGroup = 0; // Next genre group to prune once nodes are done
+
+    // Shrinking spare capacity after a sweep, requested by rebuild()
+    bool shrinking = false;
+    size_t shrinkRead = 0;
+
+    // Genres smaller than this many edges are built on the calling thread
+    static constexpr size_t PARALLEL_EDGES = 1 << 16;
+    static constexpr size_t TASK_EDGES = 1 << 15;
+
+    int findBookIndex(const std::string& isbn) const {
+        auto it = idOf.find(isbn);
+        return it == idOf.end() ? -1 : it->second;
     }
 
     int findGenreIndex(const std::string& genre) {
@@ -142,40 +359,224 @@ private:
         return -1;
     }
 
-public:
-    void addBook(const std::string& isbn, const std::string& genre) {
-        // Add to adjacency list
-        adjacencyList.push_back({isbn, std::set<std::string>()});
-        
-        // Add to genre groups
+    std::vector<int>& genreGroup(const std::string& genre) {
         int genreIndex = findGenreIndex(genre);
         if (genreIndex == -1) {
-            genreGroups.push_back({genre, std::vector<std::string>()});
+            genreGroups.push_back({genre, std::vector<int>()});
             genreIndex = genreGroups.size() - 1;
         }
-        genreGroups[genreIndex].second.push_back(isbn);
+        return genreGroups[genreIndex].second;
+    }
+
+    bool byIsbn(int a, int b) const {
+        return isbnOf[a] < isbnOf[b];
+    }
+
+    void insertNeighbour(int node, int neighbour) {
+        auto& list = adjacency[node];
+        auto it = std::lower_bound(list.begin(), list.end(), neighbour,
+                                   [this](int a, int b) { return byIsbn(a, b); });
+        if (it == list.end() || *it != neighbour) {
+            list.insert(it, neighbour);
+        }
+    }
+
+    void finishCompaction() {
+        while (compact(adjacency.size() + genreGroups.size() + 1)) {}
+    }
+
+    // Reallocate at exact size: one adjacency list per unit of budget, then
+    // the small per-graph vectors in one go
+    bool shrink(size_t& budget) {
+        while (budget > 0 && shrinkRead < adjacency.size()) {
+            --budget;
+            catalog::detail::shrink(adjacency[shrinkRead++]);
+        }
+        if (shrinkRead < adjacency.size()) return true;
+        for (auto& group : genreGroups) catalog::detail::shrink(group.second);
+        catalog::detail::shrink(genreGroups);
+        catalog::detail::shrink(adjacency);
+        catalog::detail::shrink(isbnOf);
+        catalog::detail::shrink(state);
+        catalog::detail::shrink(freeIds);
+        std::vector<int>().swap(removedBooks);
+        std::vector<int>().swap(sweepRemovals);
+        shrinking = false;
+        shrinkRead = 0;
+        return false;
+    }
+
+    // Every member of a genre links to all others; rows [begin, end) of `members`
+    // are written by one task, so tasks never share an output list
+    void connectRange(WorkStealingPool& pool, const std::vector<int>& members, size_t begin, size_t end) {
+        while (end - begin > 1 && (end - begin) * members.size() > TASK_EDGES) {
+            size_t middle = begin + (end - begin) / 2;
+            pool.submit([this, &pool, &members, middle, end] { connectRange(pool, members, middle, end); });
+            end = middle;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            auto& list = adjacency[members[i]];
+            list.reserve(members.size() - 1);
+            list.insert(list.end(), members.begin(), members.begin() + i);
+            list.insert(list.end(), members.begin() + i + 1, members.end());
+        }
+    }
+
+public:
+    void addBook(const std::string& isbn, const std::string& genre) {
+        int id = findBookIndex(isbn);
+        if (id != -1) {
+            // Same ISBN added again: one node, filed under the latest genre
+            for (auto& group : genreGroups) {
+                group.second.erase(std::remove(group.second.begin(), group.second.end(), id), group.second.end());
+            }
+        } else if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            isbnOf[id] = isbn;
+            state[id] = Live;
+        } else {
+            id = isbnOf.size();
+            isbnOf.push_back(isbn);
+            adjacency.emplace_back();
+            state.push_back(Live);
+        }
+        idOf[isbn] = id;
+        genreGroup(genre).push_back(id);
+    }
+
+    // Tombstone a book; its node and edges are dropped by compact()
+    void removeBook(const std::string& isbn) {
+        auto it = idOf.find(isbn);
+        if (it == idOf.end()) return;
+        state[it->second] = Removed;
+        removedBooks.push_back(it->second);
+        idOf.erase(it);
+    }
+
+    void changeGenre(const std::string& isbn, const std::string& oldGenre, 
+                     const std::string& newGenre) {
+        int id = findBookIndex(isbn);
+        if (id == -1) return;
+
+        int oldIndex = findGenreIndex(oldGenre);
+        if (oldIndex != -1) {
+            auto& books = genreGroups[oldIndex].second;
+            books.erase(std::remove(books.begin(), books.end(), id), books.end());
+        }
+        genreGroup(newGenre).push_back(id);
+    }
+
+    // Drop removed books visiting at most `budget` entries, then any shrink
+    // requested by rebuild(); returns true while work remains
+    bool compact(size_t budget) {
+        if (!sweeping) {
+            if (removedBooks.empty()) return shrinking && shrink(budget);
+            sweepRemovals.swap(removedBooks);
+            for (int id : sweepRemovals) state[id] = Sweeping;
+            sweeping = true;
+            sweepRead = sweepGroup = 0;
+        }
+
+        auto swept = [this](int id) { return state[id] == Sweeping; };
+        while (budget > 0 && sweepRead < adjacency.size()) {
+            --budget;
+            auto& list = adjacency[sweepRead];
+            if (state[sweepRead] == Sweeping) {
+                std::vector<int>().swap(list);
+            } else {
+                list.erase(std::remove_if(list.begin(), list.end(), swept), list.end());
+            }
+            ++sweepRead;
+        }
+        if (sweepRead < adjacency.size()) return true;
+
+        while (budget > 0 && sweepGroup < genreGroups.size()) {
+            auto& books = genreGroups[sweepGroup++].second;
+            budget = budget > books.size() ? budget - books.size() : 0;
+            books.erase(std::remove_if(books.begin(), books.end(), swept), books.end());
+        }
+        if (sweepGroup < genreGroups.size()) return true;
+
+        // Nothing refers to the swept ids any more
+        for (int id : sweepRemovals) {
+            state[id] = Free;
+            isbnOf[id].clear();
+            freeIds.push_back(id);
+        }
+        sweepRemovals.clear();
+        sweeping = false;
+        if (!removedBooks.empty()) return true;
+        return shrinking && shrink(budget);
+    }
+
+    // Ask compact() to also drop the spare capacity of every list once it
+    // has no removals left to sweep
+    void rebuild() {
+        shrinking = true;
+    }
+
+    void memory(catalog::MemoryUsage& usage) const {
+        usage.allocation(isbnOf.size() * sizeof(std::string), isbnOf.capacity() * sizeof(std::string));
+        for (const auto& isbn : isbnOf) usage.string(isbn);
+        usage.allocation(adjacency.size() * sizeof(std::vector<int>), adjacency.capacity() * sizeof(std::vector<int>));
+        for (const auto& list : adjacency) usage.allocation(list.size() * sizeof(int), list.capacity() * sizeof(int));
+        usage.allocation(state.size(), state.capacity());
+        for (const auto& entry : idOf) {
+            usage.allocation(sizeof(entry), catalog::MAP_NODE_HEADER + sizeof(entry));
+            usage.string(entry.first);
+        }
+        usage.allocation(freeIds.size() * sizeof(int), freeIds.capacity() * sizeof(int));
+        usage.allocation(genreGroups.size() * sizeof(genreGroups[0]), genreGroups.capacity() * sizeof(genreGroups[0]));
+        for (const auto& group : genreGroups) {
+            usage.string(group.first);
+            usage.allocation(group.second.size() * sizeof(int), group.second.capacity() * sizeof(int));
+        }
+        usage.allocation(removedBooks.size() * sizeof(int), removedBooks.capacity() * sizeof(int));
+        usage.allocation(sweepRemovals.size() * sizeof(int), sweepRemovals.capacity() * sizeof(int));
     }
 
     void addConnection(const std::string& book1, const std::string& book2) {
         int index1 = findBookIndex(book1);
         int index2 = findBookIndex(book2);
         
-        if (index1 != -1 && index2 != -1) {
-            adjacencyList[index1].second.insert(book2);
-            adjacencyList[index2].second.insert(book1);
+        if (index1 != -1 && index2 != -1 && index1 != index2) {
+            insertNeighbour(index1, index2);
+            insertNeighbour(index2, index1);
         }
     }
 
+    // Rebuilds all edges, in parallel across genres and within large genres
     void buildGenreConnections() {
+        // Rebuild from scratch so removed books and old genres leave no edges
+        finishCompaction();
+        for (auto& list : adjacency) {
+            list.clear();
+        }
+
         // Connect books of the same genre
-        for (const auto& genrePair : genreGroups) {
-            const auto& books = genrePair.second;
-            for (size_t i = 0; i < books.size(); ++i) {
-                for (size_t j = i + 1; j < books.size(); ++j) {
-                    addConnection(books[i], books[j]);
-                }
-            }
+        std::vector<std::vector<int>> members(genreGroups.size());
+        size_t totalEdges = 0;
+        for (size_t g = 0; g < genreGroups.size(); ++g) {
+            size_t size = genreGroups[g].second.size();
+            totalEdges += size * size;
+        }
+        size_t threadCount = 1;
+        if (totalEdges >= PARALLEL_EDGES) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
         }
+
+        WorkStealingPool pool(threadCount);
+        for (size_t g = 0; g < genreGroups.size(); ++g) {
+            pool.submit([this, &pool, &members, g] {
+                auto& group = members[g];
+                group = genreGroups[g].second;
+                std::sort(group.begin(), group.end(), [this](int a, int b) { return byIsbn(a, b); });
+                group.erase(std::unique(group.begin(), group.end()), group.end());
+                connectRange(pool, group, 0, group.size());
+            });
+        }
+        pool.wait();
     }
 
     std::vector<std::string> getRecommendations(const std::string& isbn, int maxRecs = 5) {
@@ -183,129 +584,300 @@ public:
         int bookIndex = findBookIndex(isbn);
         
         if (bookIndex != -1) {
-            for (const auto& connectedBook : adjacencyList[bookIndex].second) {
-                recommendations.push_back(connectedBook);
-                if (recommendations.size() >= maxRecs) break;
+            for (int connectedBook : adjacency[bookIndex]) {
+                if (state[connectedBook] != Live) continue;
+                recommendations.push_back(isbnOf[connectedBook]);
+                if (recommendations.size() >= static_cast<size_t>(maxRecs)) break;
             }
         }
         return recommendations;
     }
 };
 
+// Operation counters, HDR-style latency histograms and queue/undo depth
+// gauges (metrics.hpp); latency is timed for a random 1-in-N sample per thread
+enum class MetricOp {
+    Add, Remove, Update, SearchTitle, SearchISBN, GenreList, RequestBorrow, RequestReturn,
+    ProcessRequest, Undo, BuildRecommendations, Recommend, Count
+};
+enum class MetricGauge { QueueDepth, UndoDepth, Count };
+
+using Metrics = metrics::OperationMetrics<MetricOp, static_cast<size_t>(MetricOp::Count),
+                                          MetricGauge, static_cast<size_t>(MetricGauge::Count)>;
+using ScopedMetric = Metrics::Scope;
+
+const char* metricOpName(size_t op) {
+    static const char* names[Metrics::OP_COUNT] = {
+        "add", "remove", "update", "search_title", "search_isbn", "genre_list", "request_borrow",
+        "request_return", "process_request", "undo", "build_recommendations", "recommend"
+    };
+    return names[op];
+}
+
 // Main Library Management System
 class LibrarySystem {
 private:
     // Data structures used (NO HASH MAP):
-    std::list<std::shared_ptr<Book>> bookDatabase; // Linked List for book storage
-    BST titleIndex; // BST for searching by title
-    BST isbnIndex;  // BST for searching by ISBN
+    LibraryCatalog catalog; // Book storage, title/ISBN BSTs and genre buckets
     std::queue<BorrowRequest> borrowQueue; // Queue for FIFO borrow requests
     std::stack<BorrowRequest> actionHistory; // Stack for undo functionality
     RecommendationGraph recommendationSystem; // Graph for recommendations
-    
-    // Genre-based storage (Tree-like structure using vector)
-    std::vector<std::pair<std::string, std::list<std::shared_ptr<Book>>>> genreTree;
-
-    // Helper function to find book by ISBN in linked list
-    std::shared_ptr<Book> findBookByISBN(const std::string& isbn) {
-        for (const auto& book : bookDatabase) {
-            if (book->isbn == isbn) {
-                return book;
-            }
+
+    BookRenderer renderer; // Listings go through one reusable buffer
+    bool quiet = false;    // Suppress per-operation status messages
+    bool releasePending = false; // Return freed pages to the OS once compact() is done
+
+    // Compaction budget spent by every remove and update, so tombstones are
+    // swept even when no requests are processed
+    static constexpr size_t MUTATION_COMPACT_BUDGET = 32;
+
+    void status(const char* message, const std::string& detail = "") {
+        if (!quiet) {
+            std::cout << message << detail << '\n';
         }
-        return nullptr;
     }
 
-    // Helper function to find or create genre storage
-    std::list<std::shared_ptr<Book>>* getGenreList(const std::string& genre) {
-        for (auto& pair : genreTree) {
-            if (pair.first == genre) {
-                return &pair.second;
-            }
-        }
-        // Create new genre storage
-        genreTree.push_back({genre, std::list<std::shared_ptr<Book>>()});
-        return &genreTree.back().second;
+    // Index lookup without metrics, for use inside other operations
+    std::shared_ptr<Book> findLiveByISBN(const std::string& isbn) {
+        return catalog.findByISBN(isbn);
     }
 
 public:
+    LibrarySystem() = default;
+    LibrarySystem(const LibrarySystem&) = delete;
+    LibrarySystem& operator=(const LibrarySystem&) = delete;
+
+    // Gauges only sum the systems that are still alive
+    ~LibrarySystem() {
+        Metrics::adjustGauge(MetricGauge::QueueDepth, -static_cast<int64_t>(borrowQueue.size()));
+        Metrics::adjustGauge(MetricGauge::UndoDepth, -static_cast<int64_t>(actionHistory.size()));
+    }
+
+    // Quiet mode for bulk work: only listings are printed
+    void setQuiet(bool enabled) {
+        quiet = enabled;
+    }
+
+    void setOutputFormat(OutputFormat format) {
+        renderer.format = format;
+    }
+
     // Store books per genre
     void addBook(const std::string& isbn, const std::string& title, 
                  const std::string& author, const std::string& genre) {
+        ScopedMetric metric(MetricOp::Add);
         auto book = std::make_shared<Book>(isbn, title, author, genre);
         
-        // Store in linked list
-        bookDatabase.push_back(book);
-        
-        // Insert into BSTs for fast searching
-        titleIndex.insertBook(book, true);  // By title
-        isbnIndex.insertBook(book, false);  // By ISBN
-        
-        // Store in genre tree
-        auto genreList = getGenreList(genre);
-        genreList->push_back(book);
+        // Indexes by title and ISBN plus the genre bucket; a title search
+        // finds the first match in title order, then lowest ISBN
+        if (!catalog.insert(book)) {
+            status("Book with this ISBN already exists!");
+            metric.succeeded = false;
+            return;
+        }
         
         // Add to recommendation system
         recommendationSystem.addBook(isbn, genre);
         
-        std::cout << "Book added successfully!" << std::endl;
+        status("Book added successfully!");
+    }
+
+    // Remove a book: it leaves the indexes now, genre buckets and the graph
+    // are cleaned up by compactIndexes(), a small step of which runs here
+    bool removeBook(const std::string& isbn) {
+        ScopedMetric metric(MetricOp::Remove);
+        auto book = findLiveByISBN(isbn);
+        if (!book) {
+            status("Book not found!");
+            metric.succeeded = false;
+            return false;
+        }
+
+        catalog.remove(book);
+        recommendationSystem.removeBook(isbn);
+        compactIndexes(MUTATION_COMPACT_BUDGET);
+
+        status("Book removed successfully!");
+        return true;
+    }
+
+    // Update a book: the old version is tombstoned and replaced by an edited copy
+    bool updateBook(const std::string& isbn, const std::string& title, 
+                    const std::string& author, const std::string& genre) {
+        ScopedMetric metric(MetricOp::Update);
+        auto oldBook = findLiveByISBN(isbn);
+        if (!oldBook) {
+            status("Book not found!");
+            metric.succeeded = false;
+            return false;
+        }
+
+        auto book = std::make_shared<Book>(*oldBook);
+        book->title = title;
+        book->author = author;
+        book->genre = genre;
+
+        catalog.remove(oldBook);
+        catalog.insert(book);
+        if (genre != oldBook->genre) {
+            recommendationSystem.changeGenre(isbn, oldBook->genre, genre);
+        }
+        compactIndexes(MUTATION_COMPACT_BUDGET);
+
+        status("Book updated successfully!");
+        return true;
+    }
+
+    // Run one bounded step of compaction; returns true while work remains
+    bool compactIndexes(size_t budget = 256) {
+        bool genresPending = catalog.compact(budget);
+        bool graphPending = recommendationSystem.compact(budget);
+        if (genresPending || graphPending) return true;
+        if (releasePending) {
+            releasePending = false;
+            catalog::releaseMemory();
+        }
+        return false;
+    }
+
+    // Rebuild indexes, buckets and graph lists densely. The work is done in
+    // bounded steps by compactIndexes(), so requests keep being processed.
+    void compact() {
+        catalog.rebuild();
+        recommendationSystem.rebuild();
+        releasePending = true;
+    }
+
+    // Bytes held per structure: live data vs allocator/capacity overhead
+    std::vector<std::pair<std::string, catalog::MemoryUsage>> memoryReport() const {
+        LibraryCatalog::Memory indexes = catalog.memory();
+        catalog::MemoryUsage graph, queue, undo;
+        recommendationSystem.memory(graph);
+        queue.deque<BorrowRequest>(borrowQueue.size());
+        undo.deque<BorrowRequest>(actionHistory.size());
+        return {
+            {"books", indexes.records},
+            {"isbn_index", indexes.isbnIndex},
+            {"title_index", indexes.titleIndex},
+            {"genre_buckets", indexes.genres},
+            {"graph", graph},
+            {"queue", queue},
+            {"undo", undo},
+        };
     }
 
     // Organize books by title for fast searching
     std::shared_ptr<Book> searchByTitle(const std::string& title) {
-        return titleIndex.searchBook(title, true);
+        ScopedMetric metric(MetricOp::SearchTitle);
+        auto book = catalog.findByTitle(title);
+        metric.succeeded = book != nullptr;
+        return book;
     }
 
     // Organize books by ISBN for fast searching
     std::shared_ptr<Book> searchByISBN(const std::string& isbn) {
-        return isbnIndex.searchBook(isbn, false);
+        ScopedMetric metric(MetricOp::SearchISBN);
+        auto book = findLiveByISBN(isbn);
+        metric.succeeded = book != nullptr;
+        return book;
+    }
+
+    using Cursor = LibraryCatalog::Cursor;
+
+    // Cursors over the ordered indexes for paginated listing
+    Cursor seekByTitle(const std::string& title) const {
+        return catalog.seek(title, true);
+    }
+
+    Cursor seekByISBN(const std::string& isbn) const {
+        return catalog.seek(isbn, false);
+    }
+
+    // Cursor at the start of page `pageNumber`, in O(h). The BST is not
+    // rebalanced on insert, so after sorted inserts h can reach n until
+    // compact() rebuilds it; for the next page keep the cursor from visitPage()
+    Cursor pageCursor(size_t pageNumber, size_t pageSize = 50, bool byTitle = true) const {
+        return catalog.seekRank(pageNumber * pageSize, byTitle);
+    }
+
+    // Visit up to `pageSize` books from the cursor and leave it on the first
+    // book of the next page; returns how many books were visited
+    template <typename Visitor>
+    static size_t visitPage(Cursor& cursor, size_t pageSize, Visitor visit) {
+        return LibraryCatalog::visitPage(cursor, pageSize, visit);
+    }
+
+    // Display one page of books sorted by title or ISBN
+    void displayBooksPage(size_t pageNumber, size_t pageSize = 50, bool byTitle = true) {
+        renderer.writeLine("\n=== Books Page " + std::to_string(pageNumber + 1) + 
+                           " (Sorted by " + (byTitle ? "Title" : "ISBN") + ") ===");
+        Cursor cursor = pageCursor(pageNumber, pageSize, byTitle);
+        size_t shown = visitPage(cursor, pageSize, [this](const Book& book) {
+            renderer.render(book);
+        });
+        if (shown == 0) {
+            renderer.writeLine("No books on this page.");
+        }
+        renderer.flush();
     }
 
     // Display books by genre
     void displayBooksByGenre(const std::string& genre) {
-        std::cout << "\n=== Books in genre: " << genre << " ===" << std::endl;
+        ScopedMetric metric(MetricOp::GenreList);
+        renderer.writeLine("\n=== Books in genre: " + genre + " ===");
         
-        for (const auto& pair : genreTree) {
-            if (pair.first == genre) {
-                if (pair.second.empty()) {
-                    std::cout << "No books found in this genre." << std::endl;
-                    return;
-                }
-                
-                for (const auto& book : pair.second) {
-                    book->display();
-                }
-                return;
+        bool found = false;
+        bool known = catalog.visitGenre(genre, [this, &found](const std::shared_ptr<Book>& book) {
+            renderer.render(*book);
+            found = true;
+        });
+        if (known) {
+            if (!found) {
+                renderer.writeLine("No books found in this genre.");
             }
+            renderer.flush();
+            return;
         }
-        std::cout << "Genre not found." << std::endl;
+        renderer.writeLine("Genre not found.");
+        renderer.flush();
+        metric.succeeded = false;
     }
 
     // Book borrow requests (FIFO)
     void requestBorrow(const std::string& userID, const std::string& isbn) {
+        ScopedMetric metric(MetricOp::RequestBorrow);
         borrowQueue.push(BorrowRequest(userID, isbn, "BORROW"));
-        std::cout << "Borrow request added to queue." << std::endl;
+        Metrics::adjustGauge(MetricGauge::QueueDepth, 1);
+        status("Borrow request added to queue.");
     }
 
     // Book return requests (FIFO)
     void requestReturn(const std::string& userID, const std::string& isbn) {
+        ScopedMetric metric(MetricOp::RequestReturn);
         borrowQueue.push(BorrowRequest(userID, isbn, "RETURN"));
-        std::cout << "Return request added to queue." << std::endl;
+        Metrics::adjustGauge(MetricGauge::QueueDepth, 1);
+        status("Return request added to queue.");
     }
 
     // Process next request in queue
     void processNextRequest() {
+        ScopedMetric metric(MetricOp::ProcessRequest);
+        metric.succeeded = false; // Set once the request changes a book
         if (borrowQueue.empty()) {
-            std::cout << "No pending requests." << std::endl;
+            status("No pending requests.");
             return;
         }
 
         BorrowRequest request = borrowQueue.front();
         borrowQueue.pop();
+        Metrics::adjustGauge(MetricGauge::QueueDepth, -1);
+
+        // Piggyback a bounded compaction step on request processing
+        compactIndexes();
 
-        auto book = findBookByISBN(request.bookISBN);
+        auto book = findLiveByISBN(request.bookISBN);
         if (!book) {
-            std::cout << "Book not found!" << std::endl;
+            status("Book not found!");
             return;
         }
 
@@ -314,90 +886,149 @@ public:
                 book->isAvailable = false;
                 book->borrowCount++;
                 actionHistory.push(request);
-                std::cout << "Book borrowed successfully by " << request.userID << std::endl;
+                Metrics::adjustGauge(MetricGauge::UndoDepth, 1);
+                metric.succeeded = true;
+                status("Book borrowed successfully by ", request.userID);
             } else {
-                std::cout << "Book is not available for borrowing." << std::endl;
+                status("Book is not available for borrowing.");
             }
         } else if (request.action == "RETURN") {
             if (!book->isAvailable) {
                 book->isAvailable = true;
                 actionHistory.push(request);
-                std::cout << "Book returned successfully by " << request.userID << std::endl;
+                Metrics::adjustGauge(MetricGauge::UndoDepth, 1);
+                metric.succeeded = true;
+                status("Book returned successfully by ", request.userID);
             } else {
-                std::cout << "Book was not borrowed." << std::endl;
+                status("Book was not borrowed.");
             }
         }
     }
 
     // Undo last borrow/return actions
     void undoLastAction() {
+        ScopedMetric metric(MetricOp::Undo);
         if (actionHistory.empty()) {
-            std::cout << "No actions to undo." << std::endl;
+            status("No actions to undo.");
+            metric.succeeded = false;
             return;
         }
 
         BorrowRequest lastAction = actionHistory.top();
         actionHistory.pop();
+        Metrics::adjustGauge(MetricGauge::UndoDepth, -1);
 
-        auto book = findBookByISBN(lastAction.bookISBN);
+        auto book = findLiveByISBN(lastAction.bookISBN);
+        metric.succeeded = book != nullptr;
         if (book) {
             if (lastAction.action == "BORROW") {
                 book->isAvailable = true;
                 book->borrowCount--;
-                std::cout << "Undid borrow action for " << lastAction.userID << std::endl;
+                status("Undid borrow action for ", lastAction.userID);
             } else if (lastAction.action == "RETURN") {
                 book->isAvailable = false;
-                std::cout << "Undid return action for " << lastAction.userID << std::endl;
+                status("Undid return action for ", lastAction.userID);
             }
         }
     }
 
     // Connect books by similarity (book recommendation system using genres)
     void buildRecommendations() {
+        ScopedMetric metric(MetricOp::BuildRecommendations);
         recommendationSystem.buildGenreConnections();
-        std::cout << "Recommendation system built!" << std::endl;
+        status("Recommendation system built!");
     }
 
     // Get book recommendations
     void getRecommendations(const std::string& isbn) {
+        ScopedMetric metric(MetricOp::Recommend);
         auto recommendations = recommendationSystem.getRecommendations(isbn);
         
-        std::cout << "\n=== Recommendations for ISBN: " << isbn << " ===" << std::endl;
+        renderer.writeLine("\n=== Recommendations for ISBN: " + isbn + " ===");
         if (recommendations.empty()) {
-            std::cout << "No recommendations available." << std::endl;
+            renderer.writeLine("No recommendations available.");
+            renderer.flush();
+            metric.succeeded = false;
             return;
         }
 
         for (const auto& recISBN : recommendations) {
-            auto book = findBookByISBN(recISBN);
+            auto book = findLiveByISBN(recISBN);
             if (book) {
-                std::cout << "Recommended: ";
-                book->display();
+                renderer.write("Recommended: ");
+                renderer.render(*book);
             }
         }
+        renderer.flush();
     }
 
     // Display all books (sorted by title using BST)
     void displayAllBooks() {
-        std::cout << "\n=== All Books (Sorted by Title) ===" << std::endl;
-        auto books = titleIndex.getAllBooks();
-        for (const auto& book : books) {
-            book->display();
-        }
+        renderer.writeLine("\n=== All Books (Sorted by Title) ===");
+        catalog.visitAll(true, [this](const std::shared_ptr<Book>& book) {
+            renderer.render(*book);
+        });
+        renderer.flush();
     }
-
     // Display pending requests
     void displayPendingRequests() {
-        std::cout << "\n=== Pending Requests ===" << std::endl;
-        std::cout << "Number of pending requests: " << borrowQueue.size() << std::endl;
+        std::cout << "\n=== Pending Requests ===" << '\n';
+        std::cout << "Number of pending requests: " << borrowQueue.size() << '\n';
+    }
+
+    // Display per-operation counts and p50/p99/p999 latency (see Metrics)
+    void displayMetrics(std::ostream& out = std::cout) const {
+        if (!Metrics::enabled()) {
+            out << "Metrics are disabled." << '\n';
+            return;
+        }
+        Metrics::Snapshot snapshot = Metrics::read();
+        out << "\n=== Metrics ===" << '\n';
+        out << "Operation              Count       Failed    p50(ns)   p99(ns)   p999(ns)  Max(ns)" << '\n';
+        for (size_t op = 0; op < Metrics::OP_COUNT; ++op) {
+            const Metrics::OpStats& stats = snapshot.ops[op];
+            if (stats.count == 0) continue;
+            std::string line = metricOpName(op);
+            line.resize(23, ' ');
+            const int widths[] = {12, 10, 10, 10, 10};
+            const uint64_t values[] = {stats.count, stats.failed, stats.p50Ns, stats.p99Ns, stats.p999Ns};
+            for (int i = 0; i < 5; ++i) {
+                std::string column = std::to_string(values[i]);
+                column.resize(widths[i], ' ');
+                line += column;
+            }
+            out << line << stats.maxNs << '\n';
+        }
+        out << "Queue depth: " << snapshot.gauges[static_cast<size_t>(MetricGauge::QueueDepth)]
+            << ", undo depth: " << snapshot.gauges[static_cast<size_t>(MetricGauge::UndoDepth)]
+            << " (latency sampled 1 in " << Metrics::mask() + 1 << ")" << '\n';
+    }
+
+    void displayMemoryReport(std::ostream& out = std::cout) const {
+        out << "\n=== Memory ===" << '\n';
+        out << "Structure      Live(B)     Overhead(B) Total(B)" << '\n';
+        catalog::MemoryUsage total;
+        auto row = [&out](std::string name, const catalog::MemoryUsage& usage) {
+            name.resize(15, ' ');
+            std::string live = std::to_string(usage.live);
+            std::string overhead = std::to_string(usage.overhead);
+            live.resize(12, ' ');
+            overhead.resize(12, ' ');
+            out << name << live << overhead << usage.total() << '\n';
+        };
+        for (const auto& entry : memoryReport()) {
+            row(entry.first, entry.second);
+            total += entry.second;
+        }
+        row("total", total);
     }
 };
 
 // Demo function
-void runDemo() {
+void runDemo(bool showMemory = false) {
     LibrarySystem library;
 
-    std::cout << "=== Library Management & Recommendation System ===" << std::endl;
+    std::cout << "=== Library Management & Recommendation System ===" << '\n';
 
     // Store books per genre
     library.addBook("978-0134685991", "Effective Modern C++", "Scott Meyers", "Programming");
@@ -411,7 +1042,7 @@ void runDemo() {
     library.displayBooksByGenre("Programming");
 
     // Organize books by title or ISBN for fast searching
-    std::cout << "\n=== Fast Search Demo ===" << std::endl;
+    std::cout << "\n=== Fast Search Demo ===" << '\n';
     auto book = library.searchByTitle("Clean Code");
     if (book) {
         std::cout << "Found by title: ";
@@ -425,7 +1056,7 @@ void runDemo() {
     }
 
     // Book borrow/return requests (FIFO)
-    std::cout << "\n=== FIFO Borrow/Return Demo ===" << std::endl;
+    std::cout << "\n=== FIFO Borrow/Return Demo ===" << '\n';
     library.requestBorrow("user123", "978-0134685991");
     library.requestBorrow("user456", "978-0321563842");
     library.requestReturn("user123", "978-0134685991");
@@ -435,19 +1066,75 @@ void runDemo() {
     library.processNextRequest(); // Process return
 
     // Undo last borrow/return actions
-    std::cout << "\n=== Undo Last Action Demo ===" << std::endl;
+    std::cout << "\n=== Undo Last Action Demo ===" << '\n';
     library.undoLastAction();
 
     // Connect books by similarity (book recommendation system using genres)
-    std::cout << "\n=== Book Recommendation System ===" << std::endl;
+    std::cout << "\n=== Book Recommendation System ===" << '\n';
     library.buildRecommendations();
     library.getRecommendations("978-0134685991");
 
     library.displayPendingRequests();
     library.displayAllBooks();
+
+    // Paginated listing through index cursors
+    library.displayBooksPage(1, 2);
+    std::cout << "\n=== Titles from \"D\" ===" << '\n';
+    auto cursor = library.seekByTitle("D");
+    LibrarySystem::visitPage(cursor, 2, [](const Book& found) {
+        found.display();
+    });
+
+    // Remove and update books (tombstones + incremental compaction)
+    std::cout << "\n=== Remove/Update Demo ===" << '\n';
+    library.removeBook("978-0596809485");
+    library.updateBook("978-0132350884", "Clean Code (2nd Edition)", "Robert Martin", "Software Engineering");
+    while (library.compactIndexes()) {}
+    library.displayBooksByGenre("Software Engineering");
+    library.displayAllBooks();
+
+    // Machine-readable listings, bulk adds without per-book messages
+    std::cout << "\n=== TSV / JSON Lines Output Demo ===" << '\n';
+    library.setQuiet(true);
+    library.addBook("978-0262033848", "Introduction to Algorithms", "Thomas Cormen", "Computer Science");
+    library.setOutputFormat(OutputFormat::TSV);
+    library.displayBooksByGenre("Computer Science");
+    library.setOutputFormat(OutputFormat::JSONLines);
+    library.displayBooksByGenre("Computer Science");
+    library.setOutputFormat(OutputFormat::Human);
+    library.setQuiet(false);
+
+    if (Metrics::enabled()) {
+        std::cout.flush();
+        library.displayMetrics(std::cerr);
+    }
+    if (showMemory) {
+        std::cout.flush();
+        library.displayMemoryReport(std::cerr);
+        library.compact();
+        while (library.compactIndexes()) {}
+        std::cerr << "After compact():";
+        library.displayMemoryReport(std::cerr);
+    }
 }
 
-int main() {
-    runDemo();
+// benchmark.cpp includes this file and brings its own main
+#ifndef LIBRARY_NO_MAIN
+// ./library [--metrics N] [--memory]: with metrics, 1 in N operations is
+// timed and the summary goes to stderr after the demo; --memory prints the
+// memory report there before and after compact()
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    bool showMemory = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--metrics" && i + 1 < argc) {
+            Metrics::enable(static_cast<uint32_t>(std::max(1, std::atoi(argv[++i]))));
+        } else if (arg == "--memory") {
+            showMemory = true;
+        }
+    }
+    runDemo(showMemory);
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,315 @@
+// Latency metrics shared by library.cpp, perpustakaan.cpp and benchmark.cpp.
+//
+//   Buckets           HDR-style log-linear buckets: 32 per power of two, so a
+//                     bucket's upper bound is within 3% of any value in it
+//   Histogram         plain single-threaded histogram over Buckets, for a
+//                     caller that times every operation itself
+//   OperationMetrics  per-operation counters, sampled latency histograms and
+//                     gauges, one shard per thread, summed on read
+//
+// OperationMetrics is a template over each front-end's operation and gauge
+// enums, so every program (and both catalogs inside benchmark.cpp) gets its
+// own counters and enable flag.
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace metrics {
+
+struct Buckets {
+    static constexpr int SUB_BITS = 5;
+    static constexpr int MAX_BITS = 40; // Values >= 2^41 land in the last bucket
+    static constexpr size_t COUNT = size_t(MAX_BITS - SUB_BITS + 2) << SUB_BITS;
+
+    static size_t index(uint64_t value) {
+        if (value < (1u << SUB_BITS)) return value;
+        int top = 63 - __builtin_clzll(value);
+        if (top > MAX_BITS) return COUNT - 1;
+        int shift = top - SUB_BITS;
+        return (size_t(shift + 1) << SUB_BITS) + (value >> shift) - (1u << SUB_BITS);
+    }
+
+    // Highest value that falls into the bucket
+    static uint64_t upperBound(size_t index) {
+        if (index < (1u << SUB_BITS)) return index;
+        int shift = int(index >> SUB_BITS) - 1;
+        uint64_t lower = ((1ull << SUB_BITS) + (index & ((1u << SUB_BITS) - 1))) << shift;
+        return lower + (1ull << shift) - 1;
+    }
+
+    // Upper bound of the bucket holding the p-quantile of `total` values
+    static uint64_t percentile(const std::vector<uint64_t>& counts, uint64_t total, double p) {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * total)));
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            cumulative += counts[i];
+            if (cumulative >= rank) return upperBound(i);
+        }
+        return upperBound(counts.size() - 1);
+    }
+};
+
+class Histogram {
+public:
+    void record(uint64_t value) {
+        ++counts[Buckets::index(value)];
+        ++total;
+        sum += value;
+        maximum = std::max(maximum, value);
+    }
+
+    void clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = sum = maximum = 0;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+
+    // Capped at the largest recorded value, which is exact
+    uint64_t percentile(double p) const {
+        return total ? std::min(maximum, Buckets::percentile(counts, total, p)) : 0;
+    }
+
+private:
+    std::vector<uint64_t> counts = std::vector<uint64_t>(Buckets::COUNT);
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t maximum = 0;
+};
+
+// Each thread writes its own shard without atomic read-modify-writes; reads
+// sum all shards. When disabled the only cost is reading a flag that is never
+// written. Clock reads are expensive (tens of ns under virtualisation), so
+// latency is timed for a random 1-in-N sample per thread; counts cover every
+// operation.
+template <typename Op, size_t OpCount, typename Gauge, size_t GaugeCount>
+class OperationMetrics {
+public:
+    static constexpr size_t OP_COUNT = OpCount;
+    static constexpr size_t GAUGE_COUNT = GaugeCount;
+
+    // Per-thread data; only the owning thread writes
+    struct Shard {
+        std::atomic<uint64_t> buckets[OP_COUNT][Buckets::COUNT];
+        std::atomic<uint64_t> count[OP_COUNT];
+        std::atomic<uint64_t> failed[OP_COUNT];
+        std::atomic<uint64_t> totalTicks[OP_COUNT];
+        std::atomic<uint64_t> maxTicks[OP_COUNT];
+        std::atomic<int64_t> gauges[GAUGE_COUNT];
+        uint32_t random = 0x9E3779B9; // xorshift state for sampling
+
+        template <typename T>
+        static void add(std::atomic<T>& value, T n) {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        bool sample(uint32_t mask) {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            return (random & mask) == 0;
+        }
+
+        void record(size_t op, bool timed, uint64_t ticks, bool succeeded) {
+            add<uint64_t>(count[op], 1);
+            if (!succeeded) add<uint64_t>(failed[op], 1);
+            if (!timed) return;
+            add<uint64_t>(buckets[op][Buckets::index(ticks)], 1);
+            add<uint64_t>(totalTicks[op], ticks);
+            if (ticks > maxTicks[op].load(std::memory_order_relaxed)) {
+                maxTicks[op].store(ticks, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct OpStats {
+        uint64_t count = 0;
+        uint64_t failed = 0;
+        uint64_t samples = 0; // Operations whose latency was timed
+        double meanNs = 0;
+        uint64_t p50Ns = 0;
+        uint64_t p99Ns = 0;
+        uint64_t p999Ns = 0;
+        uint64_t maxNs = 0;
+    };
+
+    struct Snapshot {
+        OpStats ops[OP_COUNT];
+        int64_t gauges[GAUGE_COUNT] = {};
+    };
+
+    // Counts one operation and times it when sampled. Set `succeeded = false`
+    // before returning on a failure path.
+    class Scope {
+    private:
+        Shard* shard;
+        size_t op;
+        uint64_t start = 0;
+        bool timed = false;
+
+    public:
+        bool succeeded = true;
+
+        explicit Scope(Op op) : shard(enabled() ? threadShard() : nullptr), op(static_cast<size_t>(op)) {
+            if (shard && shard->sample(mask())) {
+                timed = true;
+                start = ticks();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            if (!shard) return;
+            shard->record(op, timed, timed ? ticks() - start : 0, succeeded);
+        }
+    };
+
+    static bool enabled() {
+        return on.load(std::memory_order_relaxed);
+    }
+
+    // `sampleEvery` is rounded up to a power of two; 1 times every operation
+    static void enable(uint32_t sampleEvery = 16) {
+        uint32_t n = 1;
+        while (n < sampleEvery && n < (1u << 30)) n <<= 1;
+        sampleMask.store(n - 1, std::memory_order_relaxed);
+        startTicks = ticks();
+        startTime = std::chrono::steady_clock::now();
+        on.store(true, std::memory_order_release);
+    }
+
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static Shard* threadShard() {
+        if (!currentShard) currentShard = registry().acquire();
+        return currentShard;
+    }
+
+    static uint32_t mask() {
+        return sampleMask.load(std::memory_order_relaxed);
+    }
+
+    static void adjustGauge(Gauge gauge, int64_t delta) {
+        if (enabled()) Shard::template add<int64_t>(threadShard()->gauges[static_cast<size_t>(gauge)], delta);
+    }
+
+    // Sums all shards; safe from any thread at any time
+    static Snapshot read() {
+        Snapshot result;
+        double nsPerTick = calibrate();
+        std::vector<uint64_t> merged(Buckets::COUNT);
+        std::lock_guard<std::mutex> guard(registry().lock);
+        for (size_t op = 0; op < OP_COUNT; ++op) {
+            OpStats& stats = result.ops[op];
+            std::fill(merged.begin(), merged.end(), 0);
+            uint64_t totalTicks = 0;
+            uint64_t maxTicks = 0;
+            for (const auto& shard : registry().all) {
+                stats.count += shard->count[op].load(std::memory_order_relaxed);
+                stats.failed += shard->failed[op].load(std::memory_order_relaxed);
+                totalTicks += shard->totalTicks[op].load(std::memory_order_relaxed);
+                maxTicks = std::max(maxTicks, shard->maxTicks[op].load(std::memory_order_relaxed));
+                for (size_t i = 0; i < Buckets::COUNT; ++i) {
+                    uint64_t n = shard->buckets[op][i].load(std::memory_order_relaxed);
+                    merged[i] += n;
+                    stats.samples += n;
+                }
+            }
+            if (stats.samples == 0) continue;
+            stats.meanNs = totalTicks * nsPerTick / stats.samples;
+            stats.maxNs = static_cast<uint64_t>(maxTicks * nsPerTick);
+            stats.p50Ns = std::min(stats.maxNs, static_cast<uint64_t>(Buckets::percentile(merged, stats.samples, 0.50) * nsPerTick));
+            stats.p99Ns = std::min(stats.maxNs, static_cast<uint64_t>(Buckets::percentile(merged, stats.samples, 0.99) * nsPerTick));
+            stats.p999Ns = std::min(stats.maxNs, static_cast<uint64_t>(Buckets::percentile(merged, stats.samples, 0.999) * nsPerTick));
+        }
+        for (const auto& shard : registry().all) {
+            for (size_t g = 0; g < GAUGE_COUNT; ++g) {
+                result.gauges[g] += shard->gauges[g].load(std::memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+private:
+    // Shards of finished threads are reused; their counts stay in the totals
+    struct Registry {
+        std::mutex lock;
+        std::vector<std::unique_ptr<Shard>> all;
+        std::vector<Shard*> free;
+
+        Shard* acquire() {
+            std::lock_guard<std::mutex> guard(lock);
+            thread_local ShardRelease release;
+            if (!free.empty()) {
+                release.shard = free.back();
+                free.pop_back();
+            } else {
+                all.emplace_back(new Shard());
+                release.shard = all.back().get();
+            }
+            return release.shard;
+        }
+    };
+
+    struct ShardRelease {
+        Shard* shard = nullptr;
+        ~ShardRelease() {
+            if (!shard) return;
+            std::lock_guard<std::mutex> guard(registry().lock);
+            registry().free.push_back(shard);
+            currentShard = nullptr;
+        }
+    };
+
+    alignas(64) static inline std::atomic<bool> on{false}; // Own cache line, read-only once enabled
+    static inline std::atomic<uint32_t> sampleMask{15};
+    static inline uint64_t startTicks = 0;
+    static inline std::chrono::steady_clock::time_point startTime;
+    static inline thread_local Shard* currentShard = nullptr;
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    // Nanoseconds per tick over the time since enable(), observed for at least 10 ms
+    static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto earliest = startTime + std::chrono::milliseconds(10);
+        if (std::chrono::steady_clock::now() < earliest) std::this_thread::sleep_until(earliest);
+        uint64_t now = ticks();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+        return now > startTicks ? ns / (now - startTicks) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
+
+} // namespace metrics
+
+#endif
@@ -7,6 +7,31 @@
 #include <limits>       // Untuk numeric_limits (digunakan oleh clearInputBuffer)
 #include <memory>       // Untuk std::shared_ptr
 #include <algorithm>    // Untuk algoritma standar (opsional, tapi baik untuk disertakan)
+#include <chrono>       // Untuk mengukur latensi mode batch
+#include <charconv>     // Untuk std::from_chars (parsing angka mode batch)
+#include <cstdio>       // Untuk fopen/fread (mode batch)
+#include <cstring>      // Untuk memchr
+#include <cstdint>      // Untuk uint64_t
+#include <string_view>  // Untuk kolom perintah tanpa salinan
+#include <thread>       // Untuk thread pekerja (mode server)
+#include <mutex>        // Untuk std::mutex
+#include <atomic>       // Untuk penerbitan snapshot dan slot epoch pembaca
+#include <condition_variable>
+#include <deque>        // Untuk antrian tugas pekerja
+#include <csignal>      // Untuk menghentikan server dengan SIGINT/SIGTERM
+#include <cerrno>       // Untuk errno (mode server)
+#ifdef __linux__
+#include <sys/epoll.h>  // Event loop mode server
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+#include "catalog_engine.hpp" // Mesin katalog bersama dengan library.cpp
+#include "metrics.hpp"        // Metrik latensi bersama dengan library.cpp
 
 using namespace std;
 
@@ -20,9 +45,10 @@ public:
     int tahunRilis; 
     int kuantitasTotal;
     int kuantitasTersedia;
+    bool dihapus; // Tombstone: buku sudah dihapus atau diganti versi barunya
 
     Buku(string judul, string penulis, string ISBN, string genre, int tahunRilis, int kuantitas)
-        : judul(judul), penulis(penulis), ISBN(ISBN), genre(genre), tahunRilis(tahunRilis), kuantitasTotal(kuantitas), kuantitasTersedia(kuantitas) {}
+        : judul(judul), penulis(penulis), ISBN(ISBN), genre(genre), tahunRilis(tahunRilis), kuantitasTotal(kuantitas), kuantitasTersedia(kuantitas), dihapus(false) {}
 
     bool pinjamBuku() {
         if (kuantitasTersedia > 0) {
@@ -41,254 +67,2565 @@ public:
     }
 
     void tampilkanInfoBuku() const {
-        cout << "Judul: " << judul << endl;
-        cout << "Penulis: " << penulis << endl;
-        cout << "ISBN: " << ISBN << endl; 
-        cout << "Genre: " << genre << endl;
-        cout << "Tahun Rilis: " << tahunRilis << endl; 
-        cout << "Kuantitas Tersedia: " << kuantitasTersedia << "/" << kuantitasTotal << endl;
+        cout << "Judul: " << judul << '\n';
+        cout << "Penulis: " << penulis << '\n';
+        cout << "ISBN: " << ISBN << '\n'; 
+        cout << "Genre: " << genre << '\n';
+        cout << "Tahun Rilis: " << tahunRilis << '\n'; 
+        cout << "Kuantitas Tersedia: " << kuantitasTersedia << "/" << kuantitasTotal << '\n';
     }
 };
 
-// --- Definisi Kelas PohonGenre ---
-class PohonGenre {
+// --- Format keluaran untuk daftar buku ---
+enum class FormatKeluaran {
+    Manusia, // Sama seperti tampilkanInfoBuku
+    TSV,     // ISBN, judul, penulis, genre, tahunRilis, tersedia, total
+    JSONL    // Satu objek JSON per baris
+};
+
+// --- Definisi Kelas PenyajiBuku ---
+// Memformat buku ke buffer yang dipakai ulang lalu menulisnya dalam blok besar
+class PenyajiBuku {
+private:
+    ostream& tujuan;
+    string buffer;
+    size_t batasFlush;
+
+    static void tambahkanTeks(string& buffer, const string& teks, FormatKeluaran format) {
+        if (format == FormatKeluaran::Manusia) {
+            buffer += teks;
+            return;
+        }
+        for (char c : teks) {
+            switch (c) {
+                case '\t': buffer += "\\t"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\\': buffer += "\\\\"; break;
+                case '"':
+                    buffer += format == FormatKeluaran::JSONL ? "\\\"" : "\"";
+                    break;
+                default:
+                    if (format == FormatKeluaran::JSONL && static_cast<unsigned char>(c) < 0x20) {
+                        static const char heksa[] = "0123456789abcdef";
+                        buffer += "\\u00";
+                        buffer += heksa[(c >> 4) & 0xF];
+                        buffer += heksa[c & 0xF];
+                    } else {
+                        buffer += c;
+                    }
+            }
+        }
+    }
+
+public:
+    FormatKeluaran format;
+
+    explicit PenyajiBuku(ostream& tujuan = cout, FormatKeluaran format = FormatKeluaran::Manusia, size_t batasFlush = 64 * 1024)
+        : tujuan(tujuan), batasFlush(batasFlush), format(format) {
+        buffer.reserve(batasFlush + 1024);
+    }
+
+    ~PenyajiBuku() {
+        flush();
+    }
+
+    // Menambahkan satu buku ke `buffer` sesuai format (dipakai juga tanpa ostream)
+    static void formatBuku(string& buffer, const Buku& buku, FormatKeluaran format) {
+        switch (format) {
+            case FormatKeluaran::Manusia:
+                buffer += "Judul: ";
+                buffer += buku.judul;
+                buffer += "\nPenulis: ";
+                buffer += buku.penulis;
+                buffer += "\nISBN: ";
+                buffer += buku.ISBN;
+                buffer += "\nGenre: ";
+                buffer += buku.genre;
+                buffer += "\nTahun Rilis: ";
+                buffer += to_string(buku.tahunRilis);
+                buffer += "\nKuantitas Tersedia: ";
+                buffer += to_string(buku.kuantitasTersedia);
+                buffer += '/';
+                buffer += to_string(buku.kuantitasTotal);
+                buffer += '\n';
+                break;
+            case FormatKeluaran::TSV:
+                tambahkanTeks(buffer, buku.ISBN, format);
+                buffer += '\t';
+                tambahkanTeks(buffer, buku.judul, format);
+                buffer += '\t';
+                tambahkanTeks(buffer, buku.penulis, format);
+                buffer += '\t';
+                tambahkanTeks(buffer, buku.genre, format);
+                buffer += '\t';
+                buffer += to_string(buku.tahunRilis);
+                buffer += '\t';
+                buffer += to_string(buku.kuantitasTersedia);
+                buffer += '\t';
+                buffer += to_string(buku.kuantitasTotal);
+                buffer += '\n';
+                break;
+            case FormatKeluaran::JSONL:
+                buffer += "{\"isbn\":\"";
+                tambahkanTeks(buffer, buku.ISBN, format);
+                buffer += "\",\"judul\":\"";
+                tambahkanTeks(buffer, buku.judul, format);
+                buffer += "\",\"penulis\":\"";
+                tambahkanTeks(buffer, buku.penulis, format);
+                buffer += "\",\"genre\":\"";
+                tambahkanTeks(buffer, buku.genre, format);
+                buffer += "\",\"tahunRilis\":";
+                buffer += to_string(buku.tahunRilis);
+                buffer += ",\"tersedia\":";
+                buffer += to_string(buku.kuantitasTersedia);
+                buffer += ",\"total\":";
+                buffer += to_string(buku.kuantitasTotal);
+                buffer += "}\n";
+                break;
+        }
+    }
+
+    void sajikan(const Buku& buku) {
+        formatBuku(buffer, buku, format);
+        if (buffer.size() >= batasFlush) {
+            flush();
+        }
+    }
+
+    // Teks bebas (judul bagian, pemisah); hanya ditulis pada format Manusia
+    void tulisBaris(const string& teks) {
+        if (format != FormatKeluaran::Manusia) return;
+        buffer += teks;
+        buffer += '\n';
+        if (buffer.size() >= batasFlush) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (buffer.empty()) return;
+        tujuan.write(buffer.data(), buffer.size());
+        buffer.clear(); // Kapasitas buffer dipertahankan untuk daftar berikutnya
+    }
+};
+
+// --- Mesin Katalog ---
+// Indeks ISBN/judul dan bucket genre memakai mesin bersama (catalog_engine.hpp)
+namespace catalog {
+template <>
+struct RecordTraits<Buku> {
+    static const string& isbn(const Buku& buku) { return buku.ISBN; }
+    static const string& title(const Buku& buku) { return buku.judul; }
+    static const string& genre(const Buku& buku) { return buku.genre; }
+    static bool deleted(const Buku& buku) { return buku.dihapus; }
+    static void markDeleted(Buku& buku) { buku.dihapus = true; }
+
+    static void memory(const Buku& buku, MemoryUsage& pemakaian) {
+        pemakaian.string(buku.judul);
+        pemakaian.string(buku.penulis);
+        pemakaian.string(buku.ISBN);
+        pemakaian.string(buku.genre);
+    }
+};
+}
+
+// Indeks std::map dengan kunci berupa view ke buku, genre terurut nama. Judul
+// diurutkan dan dicocokkan dengan kunci kolasi (tanpa beda huruf besar/kecil,
+// aksen dan artikel awal). Setiap buku punya entri judulnya sendiri; pencarian
+// judul mengambil entri pertama yang cocok, jadi judul ganda menunjuk ke ISBN
+// terkecil.
+using MesinKatalog = catalog::Engine<Buku, catalog::ViewKey, catalog::MapIndex, catalog::MapBuckets,
+                                     catalog::SingleThreaded, catalog::CollatedKey>;
+
+// --- Definisi Kelas PohonPersisten ---
+// Treap immutable dengan path copying: setiap sisip/hapus membuat O(log n)
+// simpul baru dan versi lama tetap utuh, sehingga pembaca bisa menelusuri
+// versi lama tanpa kunci sementara penulis membangun versi baru.
+using KunciGenre = pair<string_view, string_view>; // (genre, ISBN)
+using KunciJudul = pair<string, string>;            // (kunciKolasi + judul, ISBN)
+
+// Judul ternormalisasi seperti di MesinKatalog lalu '\0'. Teks ternormalisasi
+// tidak memuat byte nol, jadi judul asli yang disambung di belakangnya
+// mengikuti urutan indeks judul mesin, dan hasil fungsi ini sendiri berurut
+// sebelum semua judul yang cocok dengannya.
+inline string kunciKolasi(string_view judul) {
+    string kunci = catalog::CollatedKey::normalize(judul);
+    kunci += '\0';
+    return kunci;
+}
+
+inline int bandingkanKunci(string_view a, string_view b) {
+    return a.compare(b);
+}
+
+inline int bandingkanKunci(const KunciGenre& a, const KunciGenre& b) {
+    int hasil = a.first.compare(b.first);
+    return hasil != 0 ? hasil : a.second.compare(b.second);
+}
+
+inline int bandingkanKunci(const KunciJudul& a, const KunciJudul& b) {
+    int hasil = a.first.compare(b.first);
+    return hasil != 0 ? hasil : a.second.compare(b.second);
+}
+
+// Prioritas treap diturunkan dari kunci agar bentuk pohon deterministik
+inline size_t prioritasKunci(string_view kunci) {
+    return hash<string_view>()(kunci);
+}
+
+inline size_t prioritasKunci(const KunciGenre& kunci) {
+    return hash<string_view>()(kunci.second) * 31 + hash<string_view>()(kunci.first);
+}
+
+inline size_t prioritasKunci(const KunciJudul& kunci) {
+    return hash<string>()(kunci.second) * 31 + hash<string>()(kunci.first);
+}
+
+template <typename Kunci, typename Nilai>
+class PohonPersisten {
+public:
+    struct Simpul;
+    using Ptr = shared_ptr<const Simpul>;
+
+    struct Simpul {
+        Kunci kunci;
+        Nilai nilai;
+        size_t prioritas;
+        Ptr kiri;
+        Ptr kanan;
+
+        Simpul(const Kunci& kunci, const Nilai& nilai, size_t prioritas, Ptr kiri, Ptr kanan)
+            : kunci(kunci), nilai(nilai), prioritas(prioritas), kiri(std::move(kiri)), kanan(std::move(kanan)) {}
+    };
+
+    // Kunci boleh berupa view ke dalam `nilai`; simpul menyimpan keduanya bersama
+    static Ptr sisipkan(const Ptr& t, const Kunci& kunci, const Nilai& nilai) {
+        if (!t) {
+            return make_shared<const Simpul>(kunci, nilai, prioritasKunci(kunci), nullptr, nullptr);
+        }
+        int arah = bandingkanKunci(kunci, t->kunci);
+        if (arah == 0) {
+            return make_shared<const Simpul>(kunci, nilai, t->prioritas, t->kiri, t->kanan);
+        }
+        if (arah < 0) {
+            Ptr kiri = sisipkan(t->kiri, kunci, nilai);
+            if (kiri->prioritas > t->prioritas) { // Rotasi kanan
+                Ptr lama = make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, kiri->kanan, t->kanan);
+                return make_shared<const Simpul>(kiri->kunci, kiri->nilai, kiri->prioritas, kiri->kiri, lama);
+            }
+            return make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, kiri, t->kanan);
+        }
+        Ptr kanan = sisipkan(t->kanan, kunci, nilai);
+        if (kanan->prioritas > t->prioritas) { // Rotasi kiri
+            Ptr lama = make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, t->kiri, kanan->kiri);
+            return make_shared<const Simpul>(kanan->kunci, kanan->nilai, kanan->prioritas, lama, kanan->kanan);
+        }
+        return make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, t->kiri, kanan);
+    }
+
+    template <typename Cari>
+    static Ptr hapus(const Ptr& t, const Cari& kunci) {
+        if (!t) return t;
+        int arah = bandingkanKunci(kunci, t->kunci);
+        if (arah < 0) {
+            Ptr kiri = hapus(t->kiri, kunci);
+            return kiri == t->kiri ? t : make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, kiri, t->kanan);
+        }
+        if (arah > 0) {
+            Ptr kanan = hapus(t->kanan, kunci);
+            return kanan == t->kanan ? t : make_shared<const Simpul>(t->kunci, t->nilai, t->prioritas, t->kiri, kanan);
+        }
+        return gabung(t->kiri, t->kanan);
+    }
+
+    template <typename Cari>
+    static const Nilai* cari(const Simpul* t, const Cari& kunci) {
+        while (t) {
+            int arah = bandingkanKunci(kunci, t->kunci);
+            if (arah == 0) return &t->nilai;
+            t = arah < 0 ? t->kiri.get() : t->kanan.get();
+        }
+        return nullptr;
+    }
+
+    // Simpul pertama dengan kunci >= `kunci`, atau null
+    template <typename Cari>
+    static const Simpul* batasBawah(const Simpul* t, const Cari& kunci) {
+        const Simpul* calon = nullptr;
+        while (t) {
+            if (bandingkanKunci(t->kunci, kunci) < 0) {
+                t = t->kanan.get();
+            } else {
+                calon = t;
+                t = t->kiri.get();
+            }
+        }
+        return calon;
+    }
+
+    // Mengunjungi secara terurut semua simpul dengan posisi(kunci) == 0, di mana
+    // posisi < 0 berarti kunci di bawah rentang dan > 0 di atasnya. Subpohon
+    // yang sudah pasti di dalam rentang ditelusuri tanpa membandingkan kunci.
+    template <typename Posisi, typename Fungsi>
+    static void kunjungiRentang(const Simpul* t, Posisi& posisi, Fungsi& kunjungi, bool cekBawah = true, bool cekAtas = true) {
+        while (t) {
+            int p = (cekBawah || cekAtas) ? posisi(t->kunci) : 0;
+            if (p < 0) {
+                t = t->kanan.get();
+            } else if (p > 0) {
+                t = t->kiri.get();
+            } else {
+                kunjungiRentang(t->kiri.get(), posisi, kunjungi, cekBawah, false);
+                kunjungi(t->nilai);
+                t = t->kanan.get();
+                cekBawah = false;
+            }
+        }
+    }
+
+    template <typename Fungsi>
+    static void kunjungiSemua(const Simpul* t, Fungsi& kunjungi) {
+        auto semua = [](const Kunci&) { return 0; };
+        kunjungiRentang(t, semua, kunjungi, false, false);
+    }
+
+    // Setiap simpul satu blok make_shared (control block + simpul); `isi`
+    // menambahkan memori yang dimiliki kunci/nilai simpul itu
+    template <typename Fungsi>
+    static void hitungMemori(const Simpul* t, catalog::MemoryUsage& pemakaian, Fungsi& isi) {
+        while (t) {
+            pemakaian.allocation(sizeof(Simpul), catalog::CONTROL_BLOCK + sizeof(Simpul));
+            isi(*t, pemakaian);
+            hitungMemori(t->kiri.get(), pemakaian, isi);
+            t = t->kanan.get();
+        }
+    }
+
+private:
+    static Ptr gabung(const Ptr& a, const Ptr& b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->prioritas > b->prioritas) {
+            return make_shared<const Simpul>(a->kunci, a->nilai, a->prioritas, a->kiri, gabung(a->kanan, b));
+        }
+        return make_shared<const Simpul>(b->kunci, b->nilai, b->prioritas, gabung(a, b->kiri), b->kanan);
+    }
+};
+
+// --- Definisi Kelas SnapshotKatalog ---
+// Satu versi katalog yang tidak pernah diubah setelah diterbitkan. Kunci
+// ISBN dan genre adalah view ke buku di simpul itu sendiri. Indeks judul
+// hanya menunjuk ke ISBN, sehingga perubahan stok cukup menyalin jalur di
+// pohon ISBN dan genre (genre ikut disalin karena daftarnya dibaca per baris).
+// Seperti MesinKatalog, setiap buku punya entri judul sendiri, berurutan
+// (judul kolasi, judul, ISBN), dan pencarian judul mengambil entri pertama
+// yang kolasinya cocok.
+struct SnapshotKatalog {
+    using PohonBuku = PohonPersisten<string_view, shared_ptr<const Buku>>;
+    using PohonGenre = PohonPersisten<KunciGenre, shared_ptr<const Buku>>;
+    using PohonJudul = PohonPersisten<KunciJudul, string>; // (judul kolasi, ISBN) -> ISBN
+
+    PohonBuku::Ptr akarISBN;
+    PohonJudul::Ptr akarJudul;
+    PohonGenre::Ptr akarGenre;
+    uint64_t versi = 0;
+};
+
+// --- Definisi Kelas PembacaSnapshot ---
+// Penjaga RAII sisi pembaca: selama objek ini hidup, snapshot yang dibaca
+// tidak akan dibebaskan. Tidak ada kunci maupun perubahan refcount.
+class PembacaSnapshot {
+private:
+    atomic<uint64_t>* slot;
+    const SnapshotKatalog* snapshot;
+
+public:
+    PembacaSnapshot(atomic<uint64_t>* slot, const SnapshotKatalog* snapshot) : slot(slot), snapshot(snapshot) {}
+    PembacaSnapshot(const PembacaSnapshot&) = delete;
+    PembacaSnapshot& operator=(const PembacaSnapshot&) = delete;
+    PembacaSnapshot(PembacaSnapshot&& lain) noexcept : slot(lain.slot), snapshot(lain.snapshot) {
+        lain.slot = nullptr;
+    }
+
+    ~PembacaSnapshot() {
+        if (slot) slot->store(0, memory_order_release);
+    }
+
+    uint64_t versi() const {
+        return snapshot->versi;
+    }
+
+    const Buku* cariBukuBerdasarkanISBN(string_view ISBN) const {
+        auto hasil = SnapshotKatalog::PohonBuku::cari(snapshot->akarISBN.get(), ISBN);
+        return hasil ? hasil->get() : nullptr;
+    }
+
+    const Buku* cariBukuBerdasarkanJudul(string_view judul) const {
+        KunciJudul kunci{kunciKolasi(judul), string()};
+        auto entri = SnapshotKatalog::PohonJudul::batasBawah(snapshot->akarJudul.get(), kunci);
+        bool cocok = entri && entri->kunci.first.compare(0, kunci.first.size(), kunci.first) == 0;
+        return cocok ? cariBukuBerdasarkanISBN(entri->nilai) : nullptr;
+    }
+
+    // Buku dalam satu genre, berurutan ISBN
+    template <typename Fungsi>
+    void kunjungiGenre(string_view genre, Fungsi kunjungi) const {
+        auto posisi = [genre](const KunciGenre& kunci) { return kunci.first.compare(genre); };
+        auto f = [&kunjungi](const shared_ptr<const Buku>& buku) { kunjungi(*buku); };
+        SnapshotKatalog::PohonGenre::kunjungiRentang(snapshot->akarGenre.get(), posisi, f);
+    }
+
+    template <typename Fungsi>
+    void kunjungiSemua(Fungsi kunjungi) const {
+        auto f = [&kunjungi](const shared_ptr<const Buku>& buku) { kunjungi(*buku); };
+        SnapshotKatalog::PohonBuku::kunjungiSemua(snapshot->akarISBN.get(), f);
+    }
+};
+
+// --- Definisi Kelas PenerbitSnapshot ---
+// Sisi penulis (satu penulis pada satu waktu): perubahan dikumpulkan di
+// draf lalu diterbitkan sebagai versi baru dengan satu pertukaran atomik.
+// Versi lama dibebaskan lewat epoch: pembaca mengumumkan epoch di slotnya,
+// dan versi yang dipensiunkan pada epoch e baru dibebaskan setelah tidak ada
+// pembaca aktif dengan epoch <= e.
+class PenerbitSnapshot {
+private:
+    static constexpr size_t MAKS_PEMBACA = 128;
+
+    struct alignas(64) SlotPembaca {
+        atomic<uint64_t> epoch{0}; // 0 = tidak sedang membaca
+    };
+
+    SlotPembaca slot[MAKS_PEMBACA];
+    atomic<const SnapshotKatalog*> terkini{nullptr};
+    atomic<uint64_t> epochGlobal{1};
+    vector<pair<uint64_t, const SnapshotKatalog*>> pensiun; // Milik penulis
+    SnapshotKatalog draf;
+
+    static KunciJudul kunciJudul(const Buku& buku) {
+        return KunciJudul(kunciKolasi(buku.judul) + buku.judul, buku.ISBN);
+    }
+
+    void bebaskanYangAman() {
+        uint64_t minimum = UINT64_MAX;
+        for (const auto& s : slot) {
+            uint64_t e = s.epoch.load(memory_order_seq_cst);
+            if (e != 0 && e < minimum) minimum = e;
+        }
+        size_t tersisa = 0;
+        for (auto& versiLama : pensiun) {
+            if (versiLama.first < minimum) {
+                delete versiLama.second;
+            } else {
+                pensiun[tersisa++] = versiLama;
+            }
+        }
+        pensiun.resize(tersisa);
+    }
+
+public:
+    PenerbitSnapshot() {
+        terkini.store(new SnapshotKatalog(draf));
+    }
+
+    PenerbitSnapshot(const PenerbitSnapshot&) = delete;
+    PenerbitSnapshot& operator=(const PenerbitSnapshot&) = delete;
+
+    ~PenerbitSnapshot() {
+        delete terkini.load();
+        for (auto& versiLama : pensiun) delete versiLama.second;
+    }
+
+    // Dipanggil dari thread mana pun, tanpa kunci
+    PembacaSnapshot baca() {
+        static atomic<size_t> urutanThread{0};
+        thread_local size_t awal = urutanThread.fetch_add(1);
+        for (size_t i = awal;; ++i) {
+            SlotPembaca& s = slot[i % MAKS_PEMBACA];
+            uint64_t kosong = 0;
+            uint64_t e = epochGlobal.load(memory_order_seq_cst);
+            if (s.epoch.load(memory_order_relaxed) == 0 &&
+                s.epoch.compare_exchange_strong(kosong, e, memory_order_seq_cst)) {
+                return PembacaSnapshot(&s.epoch, terkini.load(memory_order_seq_cst));
+            }
+            if (i - awal >= MAKS_PEMBACA) this_thread::yield(); // Semua slot terpakai
+        }
+    }
+
+    // Operasi draf berikut hanya untuk penulis; belum terlihat sebelum terbitkan()
+    void sisipkan(const Buku& buku) {
+        perbarui(buku);
+        draf.akarJudul = SnapshotKatalog::PohonJudul::sisipkan(draf.akarJudul, kunciJudul(buku), buku.ISBN);
+    }
+
+    // Untuk perubahan yang tidak menyentuh judul/genre (stok pinjam/kembali)
+    void perbarui(const Buku& buku) {
+        auto salinan = make_shared<const Buku>(buku);
+        draf.akarISBN = SnapshotKatalog::PohonBuku::sisipkan(draf.akarISBN, salinan->ISBN, salinan);
+        draf.akarGenre = SnapshotKatalog::PohonGenre::sisipkan(draf.akarGenre, KunciGenre(salinan->genre, salinan->ISBN), salinan);
+    }
+
+    void hapus(const Buku& buku) {
+        draf.akarISBN = SnapshotKatalog::PohonBuku::hapus(draf.akarISBN, string_view(buku.ISBN));
+        draf.akarJudul = SnapshotKatalog::PohonJudul::hapus(draf.akarJudul, kunciJudul(buku));
+        draf.akarGenre = SnapshotKatalog::PohonGenre::hapus(draf.akarGenre, KunciGenre(buku.genre, buku.ISBN));
+    }
+
+    // Memori draf (sama dengan versi terbaru setelah terbitkan). Versi lama yang
+    // belum dibebaskan berbagi hampir semua simpulnya dengan draf, jadi tidak dihitung.
+    void memori(catalog::MemoryUsage& pemakaian) const {
+        auto buku = [](const SnapshotKatalog::PohonBuku::Simpul& s, catalog::MemoryUsage& p) {
+            p.allocation(sizeof(Buku), catalog::CONTROL_BLOCK + sizeof(Buku));
+            catalog::RecordTraits<Buku>::memory(*s.nilai, p);
+        };
+        auto judul = [](const SnapshotKatalog::PohonJudul::Simpul& s, catalog::MemoryUsage& p) {
+            p.string(s.kunci.first);
+            p.string(s.kunci.second);
+            p.string(s.nilai);
+        };
+        auto genre = [](const SnapshotKatalog::PohonGenre::Simpul&, catalog::MemoryUsage&) {}; // Buku milik pohon ISBN
+        SnapshotKatalog::PohonBuku::hitungMemori(draf.akarISBN.get(), pemakaian, buku);
+        SnapshotKatalog::PohonJudul::hitungMemori(draf.akarJudul.get(), pemakaian, judul);
+        SnapshotKatalog::PohonGenre::hitungMemori(draf.akarGenre.get(), pemakaian, genre);
+    }
+
+    void terbitkan() {
+        draf.versi++;
+        const SnapshotKatalog* lama = terkini.exchange(new SnapshotKatalog(draf), memory_order_seq_cst);
+        pensiun.push_back({epochGlobal.fetch_add(1, memory_order_seq_cst), lama});
+        bebaskanYangAman();
+    }
+};
+
+// --- Metrik Operasi ---
+// Penghitung per operasi, histogram latensi bergaya HDR dan gauge kedalaman
+// antrian/undo dari metrics.hpp. Latensi hanya diukur untuk 1 dari N operasi
+// yang dipilih acak per thread; jumlah dan kegagalan dihitung untuk semuanya.
+enum OperasiMetrik {
+    OP_TAMBAH, OP_HAPUS, OP_PERBARUI, OP_CARI_JUDUL, OP_CARI_ISBN, OP_GENRE, OP_TAHUN,
+    OP_PINJAM, OP_KEMBALI, OP_PROSES, OP_UNDO, OP_REKOMENDASI, JUMLAH_OPERASI
+};
+enum GaugeMetrik { GAUGE_ANTRIAN, GAUGE_UNDO, JUMLAH_GAUGE };
+
+const char* namaOperasiMetrik(int operasi) {
+    static const char* nama[JUMLAH_OPERASI] = {
+        "tambah", "hapus", "perbarui", "cari_judul", "cari_isbn", "genre", "tahun",
+        "pinjam", "kembali", "proses", "undo", "rekomendasi"
+    };
+    return nama[operasi];
+}
+
+const char* namaGaugeMetrik(int gauge) {
+    static const char* nama[JUMLAH_GAUGE] = { "kedalaman_antrian", "kedalaman_undo" };
+    return nama[gauge];
+}
+
+using MetrikOperasi = metrics::OperationMetrics<OperasiMetrik, JUMLAH_OPERASI, GaugeMetrik, JUMLAH_GAUGE>;
+
+class Metrik {
+public:
+    static bool aktif() {
+        return MetrikOperasi::enabled();
+    }
+
+    // `sampel` dibulatkan ke pangkat dua; 1 berarti setiap operasi diukur
+    static void aktifkan(uint32_t sampel = 16) {
+        MetrikOperasi::enable(sampel);
+    }
+
+    static void ubahGauge(GaugeMetrik gauge, int64_t delta) {
+        MetrikOperasi::adjustGauge(gauge, delta);
+    }
+
+    // Satu baris TSV per operasi yang pernah dijalankan, lalu satu per gauge:
+    //   <operasi> <jumlah> <gagal> <sampel> <p50_ns> <p99_ns> <p999_ns> <maks_ns>
+    //   <gauge> <nilai>
+    static size_t tulisTSV(string& keluaran) {
+        MetrikOperasi::Snapshot r = MetrikOperasi::read();
+        size_t baris = 0;
+        for (int op = 0; op < JUMLAH_OPERASI; ++op) {
+            const MetrikOperasi::OpStats& st = r.ops[op];
+            if (st.count == 0) continue;
+            keluaran += namaOperasiMetrik(op);
+            for (uint64_t nilai : {st.count, st.failed, st.samples, st.p50Ns, st.p99Ns, st.p999Ns, st.maxNs}) {
+                keluaran += '\t';
+                keluaran += to_string(nilai);
+            }
+            keluaran += '\n';
+            ++baris;
+        }
+        for (int g = 0; g < JUMLAH_GAUGE; ++g) {
+            keluaran += namaGaugeMetrik(g);
+            keluaran += '\t';
+            keluaran += to_string(r.gauges[g]);
+            keluaran += '\n';
+            ++baris;
+        }
+        return baris;
+    }
+
+    static void cetakTabel(ostream& keluaran) {
+        MetrikOperasi::Snapshot r = MetrikOperasi::read();
+        keluaran << "\nOperasi      Jumlah      Gagal     p50(ns)   p99(ns)   p999(ns)  Maks(ns)\n";
+        for (int op = 0; op < JUMLAH_OPERASI; ++op) {
+            const MetrikOperasi::OpStats& st = r.ops[op];
+            if (st.count == 0) continue;
+            string baris = namaOperasiMetrik(op);
+            baris.resize(13, ' ');
+            int lebar[] = {12, 10, 10, 10, 10, 10};
+            uint64_t nilai[] = {st.count, st.failed, st.p50Ns, st.p99Ns, st.p999Ns, st.maxNs};
+            for (int i = 0; i < 6; ++i) {
+                string kolom = to_string(nilai[i]);
+                if (i < 5) kolom.resize(lebar[i], ' ');
+                baris += kolom;
+            }
+            keluaran << baris << '\n';
+        }
+        keluaran << "Antrian: " << r.gauges[GAUGE_ANTRIAN] << ", undo: " << r.gauges[GAUGE_UNDO]
+                 << " (latensi dari 1 per " << MetrikOperasi::mask() + 1 << " operasi)\n";
+    }
+};
+
+// Penjaga RAII: menghitung satu operasi dan, jika terpilih sebagai sampel,
+// mengukur latensinya. Set `berhasil = false` sebelum return pada kegagalan.
+class PengukurMetrik {
+private:
+    MetrikOperasi::Scope lingkup;
+
+public:
+    bool berhasil = true;
+
+    explicit PengukurMetrik(OperasiMetrik operasi) : lingkup(operasi) {}
+
+    PengukurMetrik(const PengukurMetrik&) = delete;
+    PengukurMetrik& operator=(const PengukurMetrik&) = delete;
+
+    // Berjalan sebelum `lingkup` dihancurkan, dan lingkup itulah yang mencatat
+    ~PengukurMetrik() {
+        lingkup.succeeded = berhasil;
+    }
+};
+
+// --- Definisi Kelas Perpustakaan ---
+class Perpustakaan {
+private:
+    bool pelepasanTertunda = false; // Kembalikan memori ke OS setelah padatkan() selesai
+
+    // Batas kerja pemadatan yang dibawa setiap hapus dan perbarui
+    static constexpr size_t BATAS_PEMADATAN_TULIS = 32;
+
+    // Selama padatkan() berjalan, setiap operasi katalog (baca maupun tulis) ikut
+    // mengerjakan satu langkah, jadi beban yang hampir semuanya baca pun menyelesaikannya.
+    // Operasi yang meninggalkan tombstone (`adaTombstone`) selalu menyapu sedikit,
+    // agar tombstone tidak menumpuk walau antrian dan padatkan() tidak pernah jalan.
+    void langkahPadatkan(bool adaTombstone = false) {
+        if (pelepasanTertunda) {
+            pemadatanIndeks();
+        } else if (adaTombstone) {
+            pemadatanIndeks(BATAS_PEMADATAN_TULIS);
+        }
+    }
+
+    void tandaiDihapus(shared_ptr<Buku> buku) {
+        katalog.remove(buku);
+        if (snapshot) snapshot->hapus(*buku);
+    }
+
+    // Menyalin buku baru ke semua indeks di draf snapshot
+    void salinKeSnapshot(const shared_ptr<Buku>& buku) {
+        if (!snapshot) return;
+        snapshot->sisipkan(*buku);
+    }
+
+    void salinStokKeSnapshot(const shared_ptr<Buku>& buku) {
+        if (snapshot) snapshot->perbarui(*buku);
+    }
+
+    void terbitkanSnapshot() {
+        if (snapshot) snapshot->terbitkan();
+    }
+
+    // Permintaan di antrian/undo bisa menunjuk versi lama buku yang sudah diperbarui
+    shared_ptr<Buku> versiTerkini(shared_ptr<Buku> buku) {
+        if (buku && buku->dihapus) {
+            return temukanISBN(buku->ISBN);
+        }
+        return buku;
+    }
+
+    // Pencarian tanpa metrik untuk dipakai di dalam operasi lain
+    shared_ptr<Buku> temukanISBN(const string& ISBN) const {
+        return katalog.findByISBN(ISBN);
+    }
+
+    shared_ptr<Buku> temukanJudul(const string& judul) const {
+        return katalog.findByTitle(judul);
+    }
+
+    vector<shared_ptr<Buku>> kumpulkanTahun(int tahun) const {
+        vector<shared_ptr<Buku>> hasil;
+        katalog.visitAll(false, [&hasil, tahun](const shared_ptr<Buku>& buku) {
+            if (buku->tahunRilis == tahun) {
+                hasil.push_back(buku);
+            }
+        });
+        return hasil;
+    }
+
+    vector<shared_ptr<Buku>> kumpulkanGenre(const string& genre) const {
+        vector<shared_ptr<Buku>> hasil;
+        katalog.visitGenre(genre, [&hasil](const shared_ptr<Buku>& buku) {
+            hasil.push_back(buku);
+        });
+        return hasil;
+    }
+
+public:
+    // Buku hidup terindeks per ISBN dan judul (judul ganda: ISBN terkecil), plus bucket genre
+    MesinKatalog katalog;
+    
+    queue<pair<shared_ptr<Buku>, bool>> antrianPinjamKembali;
+    stack<pair<shared_ptr<Buku>, bool>> tumpukanUndo;
+
+    mutable PenyajiBuku penyaji; // Semua daftar buku lewat satu buffer yang dipakai ulang
+    bool modeSenyap = false;     // Tanpa pesan per buku/permintaan saat kerja massal
+
+    // Salinan katalog immutable untuk pembaca tanpa kunci (mode server).
+    // Null kecuali diaktifkan; setiap perubahan lalu diterbitkan sebagai versi baru.
+    unique_ptr<PenerbitSnapshot> snapshot;
+
+    Perpustakaan() = default;
+    Perpustakaan(const Perpustakaan&) = delete;
+    Perpustakaan& operator=(const Perpustakaan&) = delete;
+
+    // Gauge hanya menjumlahkan katalog yang masih hidup
+    ~Perpustakaan() {
+        Metrik::ubahGauge(GAUGE_ANTRIAN, -static_cast<int64_t>(antrianPinjamKembali.size()));
+        Metrik::ubahGauge(GAUGE_UNDO, -static_cast<int64_t>(tumpukanUndo.size()));
+    }
+
+    void aktifkanSnapshot() {
+        if (snapshot) return;
+        snapshot.reset(new PenerbitSnapshot());
+        katalog.visitAll(false, [this](const shared_ptr<Buku>& buku) {
+            salinKeSnapshot(buku);
+        });
+        terbitkanSnapshot();
+    }
+
+    // Hanya sah jika aktifkanSnapshot() sudah dipanggil; aman dari thread mana pun
+    PembacaSnapshot bacaSnapshot() const {
+        return snapshot->baca();
+    }
+
+    void aturModeSenyap(bool aktif) {
+        modeSenyap = aktif;
+    }
+
+    void aturFormatKeluaran(FormatKeluaran format) {
+        penyaji.format = format;
+    }
+
+    bool tambahBuku(const string& judul, const string& penulis, const string& ISBN, const string& genre, int tahunRilis, int kuantitas) {
+        PengukurMetrik ukur(OP_TAMBAH);
+        shared_ptr<Buku> bukuBaru = make_shared<Buku>(judul, penulis, ISBN, genre, tahunRilis, kuantitas);
+        if (!katalog.insert(bukuBaru)) {
+            if (!modeSenyap) cout << "Error: Buku dengan ISBN " << ISBN << " sudah ada di perpustakaan." << '\n';
+            ukur.berhasil = false;
+            return false;
+        }
+        salinKeSnapshot(bukuBaru);
+        terbitkanSnapshot();
+        langkahPadatkan();
+        if (!modeSenyap) cout << "Buku '" << judul << "' berhasil ditambahkan." << '\n';
+        return true;
+    }
+
+    // Menghapus buku: indeks map dibersihkan O(log n), entri genre ditandai usang
+    // dan dibuang bertahap oleh pemadatanIndeks(), yang juga dijalankan sedikit di sini
+    bool hapusBuku(const string& ISBN) {
+        PengukurMetrik ukur(OP_HAPUS);
+        shared_ptr<Buku> buku = temukanISBN(ISBN);
+        if (!buku) {
+            if (!modeSenyap) cout << "Error: Buku dengan ISBN " << ISBN << " tidak ditemukan." << '\n';
+            ukur.berhasil = false;
+            return false;
+        }
+        tandaiDihapus(buku);
+        terbitkanSnapshot();
+        langkahPadatkan(true);
+
+        if (!modeSenyap) cout << "Buku '" << buku->judul << "' berhasil dihapus." << '\n';
+        return true;
+    }
+
+    // Memperbarui buku: versi lama di-tombstone dan diganti salinan yang sudah diubah
+    bool perbaruiBuku(const string& ISBN, const string& judul, const string& penulis, const string& genre, int tahunRilis, int kuantitas) {
+        PengukurMetrik ukur(OP_PERBARUI);
+        shared_ptr<Buku> bukuLama = temukanISBN(ISBN);
+        if (!bukuLama) {
+            if (!modeSenyap) cout << "Error: Buku dengan ISBN " << ISBN << " tidak ditemukan." << '\n';
+            ukur.berhasil = false;
+            return false;
+        }
+        int sedangDipinjam = bukuLama->kuantitasTotal - bukuLama->kuantitasTersedia;
+        if (kuantitas < sedangDipinjam) {
+            if (!modeSenyap) cout << "Error: Kuantitas baru lebih kecil dari jumlah yang sedang dipinjam (" << sedangDipinjam << ")." << '\n';
+            ukur.berhasil = false;
+            return false;
+        }
+
+        shared_ptr<Buku> bukuBaru = make_shared<Buku>(judul, penulis, ISBN, genre, tahunRilis, kuantitas);
+        bukuBaru->kuantitasTersedia = kuantitas - sedangDipinjam;
+        tandaiDihapus(bukuLama);
+        katalog.insert(bukuBaru);
+        salinKeSnapshot(bukuBaru);
+        terbitkanSnapshot(); // Hapus + sisip terlihat sebagai satu versi
+        langkahPadatkan(true);
+        if (!modeSenyap) cout << "Buku '" << judul << "' berhasil diperbarui." << '\n';
+        return true;
+    }
+
+    // Satu langkah pemadatan dengan batas kerja; true jika masih ada yang tersisa
+    bool pemadatanIndeks(size_t batas = 256) {
+        if (katalog.compact(batas)) return true;
+        if (pelepasanTertunda) {
+            pelepasanTertunda = false;
+            catalog::releaseMemory();
+        }
+        return false;
+    }
+
+    // Membangun ulang indeks dan bucket genre secara rapat lalu mengembalikan
+    // memori yang dibebaskan ke OS. Dikerjakan bertahap oleh pemadatanIndeks(),
+    // jadi pencarian dan perubahan tetap dilayani selama proses berjalan.
+    void padatkan() {
+        katalog.rebuild();
+        pelepasanTertunda = true;
+        pemadatanIndeks();
+    }
+
+    bool sedangMemadatkan() const { return pelepasanTertunda; }
+
+    // Byte per struktur: data hidup dan overhead (kapasitas cadangan, header
+    // alokator, entri usang)
+    vector<pair<string, catalog::MemoryUsage>> laporanMemori() const {
+        using Permintaan = pair<shared_ptr<Buku>, bool>;
+        MesinKatalog::Memory indeks = katalog.memory();
+        catalog::MemoryUsage antrian, undo;
+        antrian.deque<Permintaan>(antrianPinjamKembali.size());
+        undo.deque<Permintaan>(tumpukanUndo.size());
+        vector<pair<string, catalog::MemoryUsage>> laporan = {
+            {"buku", indeks.records},
+            {"indeks_isbn", indeks.isbnIndex},
+            {"indeks_judul", indeks.titleIndex},
+            {"bucket_genre", indeks.genres},
+            {"antrian", antrian},
+            {"undo", undo},
+        };
+        if (snapshot) {
+            catalog::MemoryUsage salinan;
+            snapshot->memori(salinan);
+            laporan.push_back({"snapshot", salinan});
+        }
+        return laporan;
+    }
+
+    // Satu baris TSV per struktur lalu baris total: <struktur> <hidup> <overhead> <total>
+    static size_t tulisMemoriTSV(string& keluaran, const vector<pair<string, catalog::MemoryUsage>>& laporan) {
+        catalog::MemoryUsage total;
+        auto baris = [&keluaran](const string& nama, const catalog::MemoryUsage& pemakaian) {
+            keluaran += nama;
+            for (size_t nilai : {pemakaian.live, pemakaian.overhead, pemakaian.total()}) {
+                keluaran += '\t';
+                keluaran += to_string(nilai);
+            }
+            keluaran += '\n';
+        };
+        for (const auto& struktur : laporan) {
+            baris(struktur.first, struktur.second);
+            total += struktur.second;
+        }
+        baris("total", total);
+        return laporan.size() + 1;
+    }
+
+    shared_ptr<Buku> cariBukuBerdasarkanJudul(const string& judul) {
+        PengukurMetrik ukur(OP_CARI_JUDUL);
+        shared_ptr<Buku> buku = temukanJudul(judul);
+        ukur.berhasil = buku != nullptr;
+        langkahPadatkan();
+        return buku;
+    }
+
+    shared_ptr<Buku> cariBukuBerdasarkanISBN(const string& ISBN) {
+        PengukurMetrik ukur(OP_CARI_ISBN);
+        shared_ptr<Buku> buku = temukanISBN(ISBN);
+        ukur.berhasil = buku != nullptr;
+        langkahPadatkan();
+        return buku;
+    }
+
+    vector<shared_ptr<Buku>> dapatkanBukuDariGenre(const string& genre) {
+        PengukurMetrik ukur(OP_GENRE);
+        vector<shared_ptr<Buku>> hasil = kumpulkanGenre(genre);
+        langkahPadatkan();
+        return hasil;
+    }
+    
+    vector<shared_ptr<Buku>> cariBukuBerdasarkanTahunRilis(int tahun) {
+        PengukurMetrik ukur(OP_TAHUN);
+        vector<shared_ptr<Buku>> hasil = kumpulkanTahun(tahun);
+        langkahPadatkan();
+        return hasil;
+    }
+
+    bool ajukanPermintaanPinjam(const string& identifikasi, bool isISBN = false) {
+        PengukurMetrik ukur(OP_PINJAM);
+        shared_ptr<Buku> buku = isISBN ? temukanISBN(identifikasi) : temukanJudul(identifikasi);
+        langkahPadatkan();
+
+        if (buku) {
+            antrianPinjamKembali.push({buku, true});
+            Metrik::ubahGauge(GAUGE_ANTRIAN, 1);
+            if (!modeSenyap) cout << "Permintaan pinjam untuk '" << buku->judul << "' ditambahkan ke antrian." << '\n';
+            return true;
+        }
+        if (!modeSenyap) cout << "Buku dengan identifikasi '" << identifikasi << "' tidak ditemukan." << '\n';
+        ukur.berhasil = false;
+        return false;
+    }
+
+    bool ajukanPermintaanKembali(const string& identifikasi, bool isISBN = false) {
+        PengukurMetrik ukur(OP_KEMBALI);
+        shared_ptr<Buku> buku = isISBN ? temukanISBN(identifikasi) : temukanJudul(identifikasi);
+        langkahPadatkan();
+
+        if (buku) {
+            antrianPinjamKembali.push({buku, false});
+            Metrik::ubahGauge(GAUGE_ANTRIAN, 1);
+            if (!modeSenyap) cout << "Permintaan kembali untuk '" << buku->judul << "' ditambahkan ke antrian." << '\n';
+            return true;
+        }
+        if (!modeSenyap) cout << "Buku dengan identifikasi '" << identifikasi << "' tidak ditemukan." << '\n';
+        ukur.berhasil = false;
+        return false;
+    }
+
+    // Mengembalikan jumlah permintaan yang berhasil diproses. Jika `hasilPermintaan`
+    // diberikan, keberhasilan tiap permintaan ditambahkan ke sana sesuai urutan antrian.
+    size_t prosesAntrian(vector<bool>* hasilPermintaan = nullptr) {
+        PengukurMetrik ukur(OP_PROSES);
+        if (antrianPinjamKembali.empty()) {
+            if (!modeSenyap) cout << "Antrian pinjam/kembali kosong." << '\n';
+            return 0;
+        }
+
+        size_t berhasil = 0;
+
+        if (!modeSenyap) cout << "\n--- Memproses Antrian ---" << '\n';
+        while (!antrianPinjamKembali.empty()) {
+            pair<shared_ptr<Buku>, bool> permintaan = antrianPinjamKembali.front();
+            antrianPinjamKembali.pop();
+            Metrik::ubahGauge(GAUGE_ANTRIAN, -1);
+
+            shared_ptr<Buku> buku = versiTerkini(permintaan.first);
+            bool isPinjam = permintaan.second;
+            size_t berhasilSebelumnya = berhasil;
+
+            if (buku == nullptr) { // Tambahan: Periksa jika pointer buku itu sendiri null
+                if (!modeSenyap) cout << "Error: Buku dalam antrian tidak valid." << '\n';
+                if (hasilPermintaan) hasilPermintaan->push_back(false);
+                continue;
+            }
+
+            if (isPinjam) {
+                if (buku->pinjamBuku()) {
+                    tumpukanUndo.push({buku, true});
+                    Metrik::ubahGauge(GAUGE_UNDO, 1);
+                    salinStokKeSnapshot(buku);
+                    berhasil++;
+                    if (!modeSenyap) cout << "Berhasil meminjam: " << buku->judul << '\n';
+                } else {
+                    if (!modeSenyap) cout << "Gagal meminjam: " << buku->judul << " (Tidak ada stok)" << '\n';
+                }
+            } else {
+                if (buku->kembalikanBuku()) {
+                    tumpukanUndo.push({buku, false});
+                    Metrik::ubahGauge(GAUGE_UNDO, 1);
+                    salinStokKeSnapshot(buku);
+                    berhasil++;
+                    if (!modeSenyap) cout << "Berhasil mengembalikan: " << buku->judul << '\n';
+                } else {
+                    if (!modeSenyap) cout << "Gagal mengembalikan: " << buku->judul << " (Semua salinan sudah ada)" << '\n';
+                }
+            }
+            if (hasilPermintaan) hasilPermintaan->push_back(berhasil > berhasilSebelumnya);
+        }
+        if (!modeSenyap) cout << "-------------------------" << '\n';
+        if (berhasil > 0) terbitkanSnapshot(); // Satu versi untuk seluruh antrian
+
+        // Pemadatan bertahap menumpang pada pemrosesan antrian
+        pemadatanIndeks();
+        return berhasil;
+    }
+
+    bool undoTindakanTerakhir() {
+        PengukurMetrik ukur(OP_UNDO);
+        ukur.berhasil = false; // Hanya jalur yang berhasil mengubah stok yang menyetel true
+        if (tumpukanUndo.empty()) {
+            if (!modeSenyap) cout << "Tidak ada tindakan untuk di-undo." << '\n';
+            return false;
+        }
+
+        pair<shared_ptr<Buku>, bool> tindakanTerakhir = tumpukanUndo.top();
+        tumpukanUndo.pop();
+        Metrik::ubahGauge(GAUGE_UNDO, -1);
+
+        shared_ptr<Buku> buku = versiTerkini(tindakanTerakhir.first);
+        bool adalahPinjamAsli = tindakanTerakhir.second;
+
+        if (buku == nullptr) { // Tambahan: Periksa jika pointer buku itu sendiri null
+            if (!modeSenyap) cout << "Error: Buku dalam tumpukan undo tidak valid." << '\n';
+            return false;
+        }
+
+        if (adalahPinjamAsli) {
+            if (buku->kembalikanBuku()) {
+                salinStokKeSnapshot(buku);
+                terbitkanSnapshot();
+                if (!modeSenyap) cout << "Undo: Buku '" << buku->judul << "' berhasil dikembalikan." << '\n';
+                ukur.berhasil = true;
+                return true;
+            }
+            if (!modeSenyap) cout << "Undo gagal: Buku '" << buku->judul << "' tidak dapat dikembalikan." << '\n';
+        } else {
+            if (buku->pinjamBuku()) {
+                salinStokKeSnapshot(buku);
+                terbitkanSnapshot();
+                if (!modeSenyap) cout << "Undo: Buku '" << buku->judul << "' berhasil dipinjam kembali." << '\n';
+                ukur.berhasil = true;
+                return true;
+            }
+            if (!modeSenyap) cout << "Undo gagal: Buku '" << buku->judul << "' tidak dapat dipinjam kembali." << '\n';
+        }
+        return false;
+    }
+
+    void rekomendasikanBuku(const string& kriteria, bool isGenre = true) {
+        PengukurMetrik ukur(OP_REKOMENDASI);
+        vector<shared_ptr<Buku>> hasilRekomendasi;
+
+        if (isGenre) {
+            // Rekomendasi berdasarkan genre
+            penyaji.tulisBaris("\n--- Rekomendasi Buku dalam Genre '" + kriteria + "' ---");
+            hasilRekomendasi = kumpulkanGenre(kriteria);
+        } else {
+            // Rekomendasi berdasarkan tahun rilis
+            int tahun;
+            try {
+                tahun = stoi(kriteria); // Konversi string kriteria ke int tahun
+            } catch (const std::invalid_argument& e) {
+                cout << "Error: Input tahun rilis tidak valid (bukan angka). " << e.what() << '\n';
+                ukur.berhasil = false;
+                return;
+            } catch (const std::out_of_range& e) {
+                cout << "Error: Input tahun rilis di luar jangkauan. " << e.what() << '\n';
+                ukur.berhasil = false;
+                return;
+            }
+            penyaji.tulisBaris("\n--- Rekomendasi Buku dari Tahun Rilis " + to_string(tahun) + " ---");
+            hasilRekomendasi = kumpulkanTahun(tahun);
+        }
+
+        if (!hasilRekomendasi.empty()) {
+            for (shared_ptr<Buku> buku : hasilRekomendasi) {
+                // Tambahan: Pastikan shared_ptr tidak null sebelum diakses
+                if (buku) { 
+                    penyaji.sajikan(*buku);
+                    penyaji.tulisBaris("---------------------------------");
+                }
+            }
+        } else {
+            if (isGenre) {
+                penyaji.tulisBaris("Tidak ada buku dalam genre '" + kriteria + "'.");
+            } else {
+                penyaji.tulisBaris("Tidak ada buku yang dirilis pada tahun " + kriteria + ".");
+            }
+        }
+        penyaji.tulisBaris("---------------------------------------------------------");
+        penyaji.flush();
+    }
+    
+    // Kursor halaman di atas indeks terurut (tanpa alokasi). Kursor menjadi
+    // basi (valid() false) setelah buku ditambah, dihapus atau diperbarui, dan
+    // setelah langkah pemadatan indeks, yang juga dijalankan operasi baca
+    // selama padatkan() berjalan. Lanjutkan dengan cariPosisi dari kunci terakhir.
+    using KursorBuku = MesinKatalog::Cursor;
+
+    // Posisi buku pertama dengan kunci >= `kunci`, O(log n)
+    KursorBuku cariPosisi(const string& kunci, bool berdasarkanJudul = true) const {
+        return katalog.seek(kunci, berdasarkanJudul);
+    }
+
+    // Mengunjungi paling banyak `ukuranHalaman` buku mulai dari kursor; kursor
+    // lalu menunjuk awal halaman berikutnya
+    template <typename Fungsi>
+    static size_t kunjungiHalaman(KursorBuku& kursor, size_t ukuranHalaman, Fungsi kunjungi) {
+        return MesinKatalog::visitPage(kursor, ukuranHalaman, kunjungi);
+    }
+
+    // Menampilkan satu halaman urut ISBN mulai dari ISBN >= `kunci`,
+    // O(log n + ukuranHalaman). Mengembalikan ISBN awal halaman berikutnya,
+    // atau string kosong jika tidak ada lagi.
+    string tampilkanHalamanMulaiDari(const string& kunci, size_t ukuranHalaman = 20) const {
+        KursorBuku kursor = cariPosisi(kunci, false);
+        kunjungiHalaman(kursor, ukuranHalaman, [this](const Buku& buku) {
+            penyaji.sajikan(buku);
+            penyaji.tulisBaris("---------------------------------------");
+        });
+        penyaji.flush();
+        return kursor.valid() ? kursor.record()->ISBN : string();
+    }
+
+    // Menampilkan semua buku urut ISBN, `ukuranHalaman` buku per halaman.
+    // `lanjut()` dipanggil sebelum setiap halaman berikutnya; jika false,
+    // daftar berhenti. Tiap halaman dicari ulang dari ISBN berikutnya, jadi
+    // buku yang ditambah atau dihapus di antara halaman tidak membuat daftar
+    // mengulang atau melewatkan buku lain.
+    template <typename Fungsi>
+    void tampilkanSemuaBuku(Fungsi lanjut, size_t ukuranHalaman = 20) const {
+        if (katalog.size() == 0) {
+            penyaji.tulisBaris("Perpustakaan kosong.");
+            penyaji.flush();
+            return;
+        }
+        penyaji.tulisBaris("\n--- Daftar Semua Buku di Perpustakaan (" + to_string(katalog.size()) + " buku) ---");
+        string berikutnya;
+        size_t nomorHalaman = 1;
+        do {
+            penyaji.tulisBaris("--- Halaman " + to_string(nomorHalaman++) + " ---");
+            berikutnya = tampilkanHalamanMulaiDari(berikutnya, ukuranHalaman);
+        } while (!berikutnya.empty() && lanjut());
+    }
+
+    void tampilkanSemuaGenre() const {
+        cout << "\n--- Daftar Genre ---" << '\n';
+        bool adaGenre = false;
+        // Genre yang semua bukunya sudah dihapus tidak ditampilkan
+        katalog.visitGenres([&adaGenre](const string& genre, bool adaBuku) {
+            if (adaBuku) {
+                cout << "- " << genre << '\n';
+                adaGenre = true;
+            }
+        });
+        if (!adaGenre) {
+            cout << "Belum ada genre yang terdaftar." << '\n';
+            return;
+        }
+        cout << "--------------------" << '\n';
+    }
+};
+
+// --- Perintah Teks (dipakai mode batch dan mode server) ---
+// Satu perintah per baris, kolom dipisah TAB; baris kosong dan baris '#' diabaikan.
+// Jumlah kolom harus persis seperti di bawah; kolom lebih atau kurang ditolak.
+//   A <judul> <penulis> <ISBN> <genre> <tahun> <kuantitas>   tambah buku
+//   D <ISBN>                                                  hapus buku
+//   E <ISBN> <judul> <penulis> <genre> <tahun> <kuantitas>   perbarui buku
+//   S J|I <judul/ISBN>                                        cari buku
+//   B J|I <judul/ISBN>                                        ajukan pinjam
+//   R J|I <judul/ISBN>                                        ajukan kembali
+//   P                                                         proses antrian
+//   U                                                         undo tindakan terakhir
+//   G <genre>                                                 rekomendasi genre
+//   Y <tahun>                                                 rekomendasi tahun rilis
+//   M                                                         metrik: jumlah dan latensi p50/p99/p999 per operasi
+//   K                                                         padatkan indeks dan bucket genre (bertahap)
+//   L                                                         laporan memori: byte hidup/overhead per struktur
+enum JenisPerintah { TAMBAH, HAPUS, PERBARUI, CARI, PINJAM, KEMBALI, PROSES, UNDO, GENRE, TAHUN, METRIK, PADATKAN, MEMORI, JUMLAH_JENIS_PERINTAH };
+
+const char* namaPerintah(int jenis) {
+    static const char* nama[JUMLAH_JENIS_PERINTAH] = {
+        "tambah", "hapus", "perbarui", "cari", "pinjam", "kembali", "proses", "undo", "genre", "tahun", "metrik",
+        "padatkan", "memori"
+    };
+    return nama[jenis];
+}
+
+struct Perintah {
+    static constexpr size_t MAKS_KOLOM = 8;
+
+    JenisPerintah jenis = TAMBAH;
+    bool pakaiISBN = false;
+    int tahun = 0;
+    int kuantitas = 0;
+    string kolom[MAKS_KOLOM]; // Dipakai ulang agar tidak ada alokasi per perintah
+
+    // Perintah yang hanya membaca katalog
+    bool hanyaBaca() const {
+        return jenis == CARI || jenis == GENRE || jenis == TAHUN;
+    }
+};
+
+enum class HasilUrai { OK, KOSONG, GAGAL };
+
+// Jumlah kolom setiap jenis perintah, termasuk kolom perintahnya sendiri
+const size_t jumlahKolomPerintah[JUMLAH_JENIS_PERINTAH] = {
+    7, 2, 7, 3, 3, 3, 1, 1, 2, 2, 1, 1, 1
+};
+
+bool keAngka(string_view teks, int& hasil) {
+    auto r = from_chars(teks.data(), teks.data() + teks.size(), hasil);
+    return r.ec == errc() && r.ptr == teks.data() + teks.size();
+}
+
+// Mengurai satu baris (tanpa '\n') ke `perintah`; `alasan` diisi jika gagal
+HasilUrai uraiPerintah(const char* awal, const char* akhir, Perintah& perintah, const char*& alasan) {
+    if (akhir > awal && akhir[-1] == '\r') --akhir;
+    if (awal == akhir || *awal == '#') return HasilUrai::KOSONG;
+
+    string_view bagian[Perintah::MAKS_KOLOM];
+    size_t jumlahKolom = 0;
+    const char* p = awal;
+    while (jumlahKolom < Perintah::MAKS_KOLOM) {
+        const char* tab = static_cast<const char*>(memchr(p, '\t', akhir - p));
+        const char* ujung = tab ? tab : akhir;
+        bagian[jumlahKolom++] = string_view(p, ujung - p);
+        if (!tab) break;
+        p = tab + 1;
+    }
+    if (bagian[0].size() != 1) {
+        alasan = "perintah tidak dikenal";
+        return HasilUrai::GAGAL;
+    }
+
+    switch (bagian[0][0]) {
+        case 'A': case 'E':
+            if (jumlahKolom != 7 || !keAngka(bagian[5], perintah.tahun) || !keAngka(bagian[6], perintah.kuantitas)) {
+                alasan = "format tambah/perbarui salah";
+                return HasilUrai::GAGAL;
+            }
+            perintah.jenis = bagian[0][0] == 'A' ? TAMBAH : PERBARUI;
+            break;
+        case 'D': perintah.jenis = HAPUS; break;
+        case 'S': perintah.jenis = CARI; break;
+        case 'B': perintah.jenis = PINJAM; break;
+        case 'R': perintah.jenis = KEMBALI; break;
+        case 'P': perintah.jenis = PROSES; break;
+        case 'U': perintah.jenis = UNDO; break;
+        case 'G': perintah.jenis = GENRE; break;
+        case 'M': perintah.jenis = METRIK; break;
+        case 'K': perintah.jenis = PADATKAN; break;
+        case 'L': perintah.jenis = MEMORI; break;
+        case 'Y':
+            if (jumlahKolom != 2 || !keAngka(bagian[1], perintah.tahun)) {
+                alasan = "tahun tidak valid";
+                return HasilUrai::GAGAL;
+            }
+            perintah.jenis = TAHUN;
+            break;
+        default:
+            alasan = "perintah tidak dikenal";
+            return HasilUrai::GAGAL;
+    }
+    if (perintah.jenis == CARI || perintah.jenis == PINJAM || perintah.jenis == KEMBALI) {
+        if (jumlahKolom != 3 || bagian[1].size() != 1 || (bagian[1][0] != 'J' && bagian[1][0] != 'I')) {
+            alasan = "gunakan J <judul> atau I <ISBN>";
+            return HasilUrai::GAGAL;
+        }
+        perintah.pakaiISBN = bagian[1][0] == 'I';
+    }
+    if (jumlahKolom != jumlahKolomPerintah[perintah.jenis]) {
+        alasan = "jumlah kolom salah";
+        return HasilUrai::GAGAL;
+    }
+
+    for (size_t i = 1; i < jumlahKolom; ++i) {
+        perintah.kolom[i].assign(bagian[i].data(), bagian[i].size());
+    }
+    return HasilUrai::OK;
+}
+
+// Menjalankan perintah; buku hasil cari/rekomendasi diberikan ke `kunjungi`.
+// Mengembalikan false jika perintah ditolak (buku tidak ada, stok habis, ...)
+template <typename Fungsi>
+bool jalankanPerintah(Perpustakaan& perpustakaan, const Perintah& perintah, Fungsi kunjungi) {
+    const string* kolom = perintah.kolom;
+    switch (perintah.jenis) {
+        case TAMBAH:
+            return perpustakaan.tambahBuku(kolom[1], kolom[2], kolom[3], kolom[4], perintah.tahun, perintah.kuantitas);
+        case PERBARUI:
+            return perpustakaan.perbaruiBuku(kolom[1], kolom[2], kolom[3], kolom[4], perintah.tahun, perintah.kuantitas);
+        case HAPUS:
+            return perpustakaan.hapusBuku(kolom[1]);
+        case CARI: {
+            shared_ptr<Buku> buku = perintah.pakaiISBN ? perpustakaan.cariBukuBerdasarkanISBN(kolom[2])
+                                                       : perpustakaan.cariBukuBerdasarkanJudul(kolom[2]);
+            if (buku) kunjungi(*buku);
+            return true;
+        }
+        case PINJAM:
+            return perpustakaan.ajukanPermintaanPinjam(kolom[2], perintah.pakaiISBN);
+        case KEMBALI:
+            return perpustakaan.ajukanPermintaanKembali(kolom[2], perintah.pakaiISBN);
+        case PROSES:
+            perpustakaan.prosesAntrian();
+            return true;
+        case UNDO:
+            return perpustakaan.undoTindakanTerakhir();
+        case GENRE:
+            for (const auto& buku : perpustakaan.dapatkanBukuDariGenre(kolom[1])) kunjungi(*buku);
+            return true;
+        case TAHUN:
+            for (const auto& buku : perpustakaan.cariBukuBerdasarkanTahunRilis(perintah.tahun)) kunjungi(*buku);
+            return true;
+        case PADATKAN:
+            perpustakaan.padatkan();
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Versi baca-saja dari jalankanPerintah di atas satu snapshot; tanpa kunci.
+// Buku genre dikunjungi berurutan ISBN, bukan urutan penambahan.
+template <typename Fungsi>
+bool jalankanPerintahBaca(const PembacaSnapshot& pembaca, const Perintah& perintah, Fungsi kunjungi) {
+    switch (perintah.jenis) {
+        case CARI: {
+            PengukurMetrik ukur(perintah.pakaiISBN ? OP_CARI_ISBN : OP_CARI_JUDUL);
+            const Buku* buku = perintah.pakaiISBN ? pembaca.cariBukuBerdasarkanISBN(perintah.kolom[2])
+                                                  : pembaca.cariBukuBerdasarkanJudul(perintah.kolom[2]);
+            ukur.berhasil = buku != nullptr;
+            if (buku) kunjungi(*buku);
+            return true;
+        }
+        case GENRE: {
+            PengukurMetrik ukur(OP_GENRE);
+            pembaca.kunjungiGenre(perintah.kolom[1], kunjungi);
+            return true;
+        }
+        case TAHUN: {
+            PengukurMetrik ukur(OP_TAHUN);
+            pembaca.kunjungiSemua([&](const Buku& buku) {
+                if (buku.tahunRilis == perintah.tahun) kunjungi(buku);
+            });
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// --- Definisi Kelas KatalogBershard ---
+// Katalog dipecah menjadi N shard berdasarkan hash ISBN. Setiap shard adalah
+// Perpustakaan tersendiri yang hanya disentuh oleh thread pemiliknya; thread
+// lain mengirim tugas lewat antrian shard. Perintah berkunci ISBN dikirim ke
+// satu shard, sedangkan cari judul, genre, tahun dan proses antrian dikirim ke
+// semua shard pada posisi yang sama di antrian masing-masing, sehingga setiap
+// shard melihat keadaan yang sama seperti eksekusi berurutan tanpa perlu
+// menunggu shard lain. Hasil fan-out digabung berurutan ISBN.
+class KatalogBershard {
+public:
+    // Hasil satu perintah; dipakai ulang antar jendela agar tidak alokasi ulang
+    struct HasilPerintah {
+        struct Bagian {
+            vector<Buku> buku;
+            uint64_t ns = 0;
+            vector<uint64_t> urutanBerhasil; // Untuk PROSES: nomor urut permintaan yang berhasil di shard ini
+            bool berhasil = false;
+        };
+
+        vector<Bagian> bagian; // Satu per shard
+        size_t shard = 0;      // Shard tujuan untuk perintah satu-shard
+        vector<Buku> buku;     // Hasil gabungan, terisi setelah jendela selesai
+        uint64_t ns = 0;       // Waktu eksekusi terlama di antara shard yang terlibat
+        bool berhasil = false;
+    };
+
+private:
+    struct Jendela {
+        atomic<size_t> sisa{0};
+        mutex kunci;
+        condition_variable selesai;
+    };
+
+    struct Tugas {
+        const Perintah* perintah;
+        HasilPerintah* hasil;
+        Jendela* jendela;
+        uint64_t urutan; // Posisi perintah dalam eksekusi berurutan, mulai dari 1
+    };
+
+    struct Shard {
+        Perpustakaan perpustakaan;
+        mutex kunci;
+        condition_variable adaTugas;
+        vector<Tugas> antrian;
+        bool berhenti = false;
+        thread pemilik;
+
+        // Hanya disentuh thread pemilik
+        deque<uint64_t> urutanAntrian; // Nomor urut permintaan pinjam/kembali yang menunggu PROSES
+        vector<bool> hasilProses;
+    };
+
+    vector<unique_ptr<Shard>> daftarShard;
+    uint64_t urutanBerikutnya = 1;
+    mutex kunciUndo;
+    vector<size_t> riwayatUndo; // Shard tiap tindakan yang bisa di-undo, urut permintaan diajukan
+
+    static bool fanOut(const Perintah& perintah) {
+        return perintah.jenis == GENRE || perintah.jenis == TAHUN || perintah.jenis == PROSES ||
+               perintah.jenis == PADATKAN || (perintah.jenis == CARI && !perintah.pakaiISBN);
+    }
+
+    // Perintah yang bergantung pada hasil shard lain harus menunggu jendela selesai
+    static bool pembatas(const Perintah& perintah) {
+        return perintah.jenis == UNDO ||
+               ((perintah.jenis == PINJAM || perintah.jenis == KEMBALI) && !perintah.pakaiISBN);
+    }
+
+    size_t shardUntuk(const Perintah& perintah) const {
+        const string& ISBN = perintah.jenis == TAMBAH ? perintah.kolom[3]
+                             : (perintah.jenis == PERBARUI || perintah.jenis == HAPUS) ? perintah.kolom[1]
+                                                                                       : perintah.kolom[2];
+        return hash<string>()(ISBN) % daftarShard.size();
+    }
+
+    void kerjakan(size_t indeks, const Tugas& tugas) {
+        Shard& shard = *daftarShard[indeks];
+        Perpustakaan& perpustakaan = shard.perpustakaan;
+        HasilPerintah::Bagian& bagian = tugas.hasil->bagian[indeks];
+        JenisPerintah jenis = tugas.perintah->jenis;
+        bagian.buku.clear();
+        auto mulai = chrono::steady_clock::now();
+        if (jenis == PROSES) {
+            shard.hasilProses.clear();
+            perpustakaan.prosesAntrian(&shard.hasilProses);
+            bagian.urutanBerhasil.clear();
+            for (bool berhasil : shard.hasilProses) {
+                if (berhasil) bagian.urutanBerhasil.push_back(shard.urutanAntrian.front());
+                shard.urutanAntrian.pop_front();
+            }
+            bagian.berhasil = true;
+        } else {
+            bagian.berhasil = jalankanPerintah(perpustakaan, *tugas.perintah, [&bagian](const Buku& buku) {
+                bagian.buku.push_back(buku);
+            });
+            if (bagian.berhasil && (jenis == PINJAM || jenis == KEMBALI)) shard.urutanAntrian.push_back(tugas.urutan);
+        }
+        bagian.ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - mulai).count();
+    }
+
+    static void kurangiSisa(Jendela* jendela, size_t jumlah) {
+        if (jendela->sisa.fetch_sub(jumlah, memory_order_acq_rel) == jumlah) {
+            lock_guard<mutex> kunci(jendela->kunci);
+            jendela->selesai.notify_one();
+        }
+    }
+
+    void jalankanPemilik(size_t indeks) {
+        Shard& shard = *daftarShard[indeks];
+        vector<Tugas> lokal;
+        while (true) {
+            {
+                unique_lock<mutex> kunci(shard.kunci);
+                shard.adaTugas.wait(kunci, [&] { return shard.berhenti || !shard.antrian.empty(); });
+                if (shard.antrian.empty()) return;
+                lokal.swap(shard.antrian);
+            }
+            // Penyelesaian dihitung per jendela berurutan, bukan per tugas
+            Jendela* jendela = nullptr;
+            size_t selesai = 0;
+            for (const Tugas& tugas : lokal) {
+                if (tugas.jendela != jendela) {
+                    if (jendela) kurangiSisa(jendela, selesai);
+                    jendela = tugas.jendela;
+                    selesai = 0;
+                }
+                kerjakan(indeks, tugas);
+                selesai++;
+            }
+            if (jendela) kurangiSisa(jendela, selesai);
+            lokal.clear();
+        }
+    }
+
+    void kirim(size_t indeks, const vector<Tugas>& daftar) {
+        Shard& shard = *daftarShard[indeks];
+        {
+            lock_guard<mutex> kunci(shard.kunci);
+            shard.antrian.insert(shard.antrian.end(), daftar.begin(), daftar.end());
+        }
+        shard.adaTugas.notify_one();
+    }
+
+    static void tunggu(Jendela& jendela) {
+        unique_lock<mutex> kunci(jendela.kunci);
+        jendela.selesai.wait(kunci, [&] { return jendela.sisa.load(memory_order_acquire) == 0; });
+    }
+
+    // Mengirim perintah [awal, akhir) ke shard lalu menunggu semuanya selesai
+    void kirimDanTunggu(const Perintah* perintah, HasilPerintah* hasil, size_t awal, size_t akhir,
+                        vector<vector<Tugas>>& perShard, Jendela& jendela) {
+        size_t jumlahTugas = 0;
+        for (size_t i = awal; i < akhir; ++i) {
+            uint64_t urutan = urutanBerikutnya++;
+            if (fanOut(perintah[i])) {
+                for (auto& daftar : perShard) daftar.push_back({&perintah[i], &hasil[i], &jendela, urutan});
+                jumlahTugas += perShard.size();
+            } else {
+                hasil[i].shard = shardUntuk(perintah[i]);
+                perShard[hasil[i].shard].push_back({&perintah[i], &hasil[i], &jendela, urutan});
+                jumlahTugas++;
+            }
+        }
+        if (jumlahTugas == 0) return;
+
+        jendela.sisa.store(jumlahTugas, memory_order_relaxed);
+        for (size_t s = 0; s < perShard.size(); ++s) {
+            if (perShard[s].empty()) continue;
+            kirim(s, perShard[s]);
+            perShard[s].clear();
+        }
+        tunggu(jendela);
+
+        for (size_t i = awal; i < akhir; ++i) gabungkan(perintah[i], hasil[i]);
+    }
+
+    void gabungkan(const Perintah& perintah, HasilPerintah& hasil) {
+        hasil.buku.clear();
+        hasil.ns = 0;
+        if (!fanOut(perintah)) {
+            HasilPerintah::Bagian& bagian = hasil.bagian[hasil.shard];
+            hasil.berhasil = bagian.berhasil;
+            hasil.ns = bagian.ns;
+            hasil.buku.swap(bagian.buku);
+            return;
+        }
+        hasil.berhasil = true;
+        for (size_t s = 0; s < hasil.bagian.size(); ++s) {
+            HasilPerintah::Bagian& bagian = hasil.bagian[s];
+            hasil.ns = max(hasil.ns, bagian.ns);
+            hasil.buku.insert(hasil.buku.end(), make_move_iterator(bagian.buku.begin()), make_move_iterator(bagian.buku.end()));
+        }
+        if (perintah.jenis == PROSES) {
+            // Antrian tunggal memproses permintaan sesuai urutan diajukan, jadi
+            // riwayat undo disusun dengan urutan yang sama, bukan per shard
+            vector<pair<uint64_t, size_t>> tindakan;
+            for (size_t s = 0; s < hasil.bagian.size(); ++s) {
+                for (uint64_t urutan : hasil.bagian[s].urutanBerhasil) tindakan.push_back({urutan, s});
+            }
+            sort(tindakan.begin(), tindakan.end());
+            lock_guard<mutex> kunci(kunciUndo);
+            for (const auto& t : tindakan) riwayatUndo.push_back(t.second);
+        }
+        if (perintah.jenis == CARI && hasil.buku.size() > 1) {
+            // Judul cocok di beberapa shard: ambil yang pertama dalam urutan indeks judul
+            using Kunci = MesinKatalog::TitleKey;
+            auto pertama = min_element(hasil.buku.begin(), hasil.buku.end(), [](const Buku& a, const Buku& b) {
+                return Kunci::compare(Kunci::make(a.judul, a.ISBN), Kunci::make(b.judul, b.ISBN)) < 0;
+            });
+            swap(hasil.buku.front(), *pertama);
+            hasil.buku.erase(hasil.buku.begin() + 1, hasil.buku.end());
+        }
+        sort(hasil.buku.begin(), hasil.buku.end(), [](const Buku& a, const Buku& b) { return a.ISBN < b.ISBN; });
+    }
+
+    // Perintah pembatas dijalankan sendiri setelah semua perintah sebelumnya selesai
+    void jalankanPembatas(const Perintah& perintah, HasilPerintah& hasil, vector<vector<Tugas>>& perShard, Jendela& jendela) {
+        hasil.buku.clear();
+        if (perintah.jenis == UNDO) {
+            size_t shard;
+            {
+                lock_guard<mutex> kunci(kunciUndo);
+                if (riwayatUndo.empty()) {
+                    hasil.berhasil = false;
+                    return;
+                }
+                shard = riwayatUndo.back();
+                riwayatUndo.pop_back();
+            }
+            jendela.sisa.store(1, memory_order_relaxed);
+            kirim(shard, {{&perintah, &hasil, &jendela, urutanBerikutnya++}});
+            tunggu(jendela);
+            hasil.berhasil = hasil.bagian[shard].berhasil;
+            hasil.ns = hasil.bagian[shard].ns;
+            return;
+        }
+
+        // Pinjam/kembali berdasarkan judul: cari pemilik judul dulu, lalu kirim per ISBN
+        Perintah turunan;
+        turunan.jenis = CARI;
+        turunan.pakaiISBN = false;
+        turunan.kolom[2] = perintah.kolom[2];
+        kirimDanTunggu(&turunan, &hasil, 0, 1, perShard, jendela);
+        if (hasil.buku.empty()) {
+            hasil.berhasil = false;
+            return;
+        }
+        uint64_t nsCari = hasil.ns;
+        turunan.jenis = perintah.jenis;
+        turunan.pakaiISBN = true;
+        turunan.kolom[2] = hasil.buku.front().ISBN;
+        kirimDanTunggu(&turunan, &hasil, 0, 1, perShard, jendela);
+        hasil.ns += nsCari;
+    }
+
 public:
-    map<string, vector<shared_ptr<Buku>>> daftarGenre;
+    explicit KatalogBershard(size_t jumlahShard) {
+        for (size_t i = 0; i < jumlahShard; ++i) {
+            daftarShard.emplace_back(new Shard());
+            daftarShard.back()->perpustakaan.aturModeSenyap(true);
+        }
+        for (size_t i = 0; i < jumlahShard; ++i) {
+            daftarShard[i]->pemilik = thread(&KatalogBershard::jalankanPemilik, this, i);
+        }
+    }
+
+    KatalogBershard(const KatalogBershard&) = delete;
+    KatalogBershard& operator=(const KatalogBershard&) = delete;
+
+    ~KatalogBershard() {
+        for (auto& shard : daftarShard) {
+            {
+                lock_guard<mutex> kunci(shard->kunci);
+                shard->berhenti = true;
+            }
+            shard->adaTugas.notify_one();
+        }
+        for (auto& shard : daftarShard) shard->pemilik.join();
+    }
+
+    size_t jumlahShard() const {
+        return daftarShard.size();
+    }
+
+    // Jumlah laporan memori semua shard. Hanya sah di antara jendela, saat
+    // setiap thread shard sedang menunggu tugas berikutnya.
+    vector<pair<string, catalog::MemoryUsage>> laporanMemori() const {
+        vector<pair<string, catalog::MemoryUsage>> total;
+        for (const auto& shard : daftarShard) {
+            auto laporan = shard->perpustakaan.laporanMemori();
+            if (total.empty()) {
+                total = std::move(laporan);
+                continue;
+            }
+            for (size_t i = 0; i < laporan.size(); ++i) total[i].second += laporan[i].second;
+        }
+        return total;
+    }
+
+    // Menjalankan n perintah dengan semantik berurutan; hasil[i] untuk perintah[i].
+    // Perintah antar shard berjalan paralel; hanya undo dan pinjam/kembali per
+    // judul yang menunggu perintah sebelumnya selesai.
+    void jalankanJendela(const Perintah* perintah, HasilPerintah* hasil, size_t n) {
+        vector<vector<Tugas>> perShard(daftarShard.size());
+        Jendela jendela;
+        for (size_t i = 0; i < n; ++i) {
+            if (hasil[i].bagian.size() != daftarShard.size()) hasil[i].bagian.resize(daftarShard.size());
+        }
+        size_t awal = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (!pembatas(perintah[i])) continue;
+            kirimDanTunggu(perintah, hasil, awal, i, perShard, jendela);
+            jalankanPembatas(perintah[i], hasil[i], perShard, jendela);
+            awal = i + 1;
+        }
+        kirimDanTunggu(perintah, hasil, awal, n, perShard, jendela);
+    }
+};
+
+// --- Definisi Kelas EksekutorBatch (mode non-interaktif) ---
+class EksekutorBatch {
+private:
+    struct StatistikPerintah {
+        uint64_t jumlah = 0;
+        uint64_t totalNs = 0;
+        uint64_t maksNs = 0;
+    };
 
-    void tambahBukuKeGenre(shared_ptr<Buku> buku) {
-        daftarGenre[buku->genre].push_back(buku);
-    }
+    static constexpr size_t UKURAN_BLOK = 1 << 20;
+    static constexpr size_t UKURAN_JENDELA = 4096; // Perintah per kiriman ke shard
 
-    vector<shared_ptr<Buku>> dapatkanBukuBerdasarkanGenre(const string& genre) {
-        if (daftarGenre.count(genre)) {
-            return daftarGenre[genre];
-        }
-        return {};
+    Perpustakaan& perpustakaan;
+    bool tampilkanHasil; // Hasil cari/rekomendasi ditulis lewat penyaji
+    StatistikPerintah statistik[JUMLAH_JENIS_PERINTAH];
+    uint64_t barisGagal = 0;
+    uint64_t bukuDitemukan = 0;
+    Perintah perintah;
+
+    // Mode bershard: perintah dikumpulkan per jendela lalu dijalankan paralel
+    KatalogBershard* katalogBershard;
+    vector<Perintah> jendela;
+    vector<KatalogBershard::HasilPerintah> hasilJendela;
+    size_t isiJendela = 0;
+
+    void catat(JenisPerintah jenis, uint64_t ns) {
+        StatistikPerintah& st = statistik[jenis];
+        st.jumlah++;
+        st.totalNs += ns;
+        if (ns > st.maksNs) st.maksNs = ns;
     }
 
-    void tampilkanSemuaGenre() const {
-        cout << "\n--- Daftar Genre ---" << endl;
-        if (daftarGenre.empty()) {
-            cout << "Belum ada genre yang terdaftar." << endl;
+    // Mengurai dan menjalankan satu baris; latensi hanya mencakup eksekusi
+    void jalankanBaris(const char* awal, const char* akhir, size_t nomorBaris) {
+        const char* alasan = nullptr;
+        Perintah& tujuan = katalogBershard ? jendela[isiJendela] : perintah;
+        HasilUrai hasil = uraiPerintah(awal, akhir, tujuan, alasan);
+        if (hasil == HasilUrai::KOSONG) return;
+        if (hasil == HasilUrai::GAGAL) {
+            if (barisGagal++ < 10) {
+                cerr << "Baris " << nomorBaris << ": " << alasan << '\n';
+            }
+            return;
+        }
+        if (tujuan.jenis == METRIK || tujuan.jenis == MEMORI) {
+            if (isiJendela > 0) kosongkanJendela(); // Termasuk semua perintah sebelumnya
+            if (tujuan.jenis == METRIK) {
+                cetakMetrik();
+            } else {
+                cetakMemori();
+            }
             return;
         }
-        for (const auto& pair : daftarGenre) {
-            cout << "- " << pair.first << endl;
+        if (katalogBershard) {
+            if (++isiJendela == jendela.size()) kosongkanJendela();
+            return;
         }
-        cout << "--------------------" << endl;
+
+        auto mulai = chrono::steady_clock::now();
+        jalankanPerintah(perpustakaan, perintah, [this](const Buku& buku) {
+            bukuDitemukan++;
+            if (tampilkanHasil) perpustakaan.penyaji.sajikan(buku);
+        });
+        uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - mulai).count();
+        catat(perintah.jenis, ns);
     }
-};
 
-// --- Definisi Kelas Perpustakaan ---
-class Perpustakaan {
-public:
-    map<string, shared_ptr<Buku>> bukuBerdasarkanISBN; 
-    map<string, shared_ptr<Buku>> bukuBerdasarkanJudul; 
-    
-    queue<pair<shared_ptr<Buku>, bool>> antrianPinjamKembali;
-    stack<pair<shared_ptr<Buku>, bool>> tumpukanUndo;
-    PohonGenre pohonGenre;
+    // Latensi mode bershard adalah waktu eksekusi di shard, tanpa antrian
+    void kosongkanJendela() {
+        katalogBershard->jalankanJendela(jendela.data(), hasilJendela.data(), isiJendela);
+        for (size_t i = 0; i < isiJendela; ++i) {
+            const KatalogBershard::HasilPerintah& hasil = hasilJendela[i];
+            catat(jendela[i].jenis, hasil.ns);
+            bukuDitemukan += hasil.buku.size();
+            if (tampilkanHasil) {
+                for (const Buku& buku : hasil.buku) perpustakaan.penyaji.sajikan(buku);
+            }
+        }
+        isiJendela = 0;
+    }
 
-    void tambahBuku(const string& judul, const string& penulis, const string& ISBN, const string& genre, int tahunRilis, int kuantitas) {
-        if (bukuBerdasarkanISBN.count(ISBN)) {
-            cout << "Error: Buku dengan ISBN " << ISBN << " sudah ada di perpustakaan." << endl;
+    void cetakMetrik() {
+        if (!Metrik::aktif()) {
+            cerr << "Metrik tidak aktif (jalankan dengan --metrik N)" << '\n';
             return;
         }
-        shared_ptr<Buku> bukuBaru = make_shared<Buku>(judul, penulis, ISBN, genre, tahunRilis, kuantitas);
-        
-        bukuBerdasarkanISBN[ISBN] = bukuBaru;   
-        bukuBerdasarkanJudul[judul] = bukuBaru; 
-        pohonGenre.tambahBukuKeGenre(bukuBaru); 
-        cout << "Buku '" << judul << "' berhasil ditambahkan." << endl;
+        string keluaran;
+        Metrik::tulisTSV(keluaran);
+        cerr << keluaran;
     }
 
-    shared_ptr<Buku> cariBukuBerdasarkanJudul(const string& judul) {
-        if (bukuBerdasarkanJudul.count(judul)) {
-            return bukuBerdasarkanJudul[judul];
-        }
-        return nullptr;
+    void cetakMemori() {
+        string keluaran;
+        Perpustakaan::tulisMemoriTSV(keluaran, katalogBershard ? katalogBershard->laporanMemori()
+                                                               : perpustakaan.laporanMemori());
+        cerr << keluaran;
     }
 
-    shared_ptr<Buku> cariBukuBerdasarkanISBN(const string& ISBN) {
-        if (bukuBerdasarkanISBN.count(ISBN)) {
-            return bukuBerdasarkanISBN[ISBN];
+public:
+    EksekutorBatch(Perpustakaan& perpustakaan, bool tampilkanHasil, KatalogBershard* katalogBershard = nullptr)
+        : perpustakaan(perpustakaan), tampilkanHasil(tampilkanHasil), katalogBershard(katalogBershard) {
+        if (katalogBershard) {
+            jendela.resize(UKURAN_JENDELA);
+            hasilJendela.resize(UKURAN_JENDELA);
         }
-        return nullptr;
     }
 
-    vector<shared_ptr<Buku>> dapatkanBukuDariGenre(const string& genre) {
-        return pohonGenre.dapatkanBukuBerdasarkanGenre(genre);
-    }
-    
-    vector<shared_ptr<Buku>> cariBukuBerdasarkanTahunRilis(int tahun) {
-        vector<shared_ptr<Buku>> hasil;
-        for (const auto& pair : bukuBerdasarkanISBN) { 
-            if (pair.second->tahunRilis == tahun) {
-                hasil.push_back(pair.second);
+    // Membaca berkas per blok besar dan menjalankan setiap baris lengkap
+    void jalankanBerkas(FILE* berkas) {
+        vector<char> blok(UKURAN_BLOK);
+        size_t sisa = 0; // Potongan baris terakhir yang belum lengkap
+        size_t nomorBaris = 0;
+        while (true) {
+            if (sisa == blok.size()) {
+                blok.resize(blok.size() * 2); // Baris lebih panjang dari blok
+            }
+            size_t terbaca = fread(blok.data() + sisa, 1, blok.size() - sisa, berkas);
+            size_t ukuran = sisa + terbaca;
+            const char* p = blok.data();
+            const char* akhir = blok.data() + ukuran;
+            while (const char* nl = static_cast<const char*>(memchr(p, '\n', akhir - p))) {
+                jalankanBaris(p, nl, ++nomorBaris);
+                p = nl + 1;
+            }
+            sisa = akhir - p;
+            if (terbaca == 0) {
+                if (sisa > 0) jalankanBaris(p, akhir, ++nomorBaris);
+                break;
             }
+            memmove(blok.data(), p, sisa);
         }
-        return hasil;
+        if (isiJendela > 0) kosongkanJendela();
+        perpustakaan.penyaji.flush();
     }
 
-    void ajukanPermintaanPinjam(const string& identifikasi, bool isISBN = false) {
-        shared_ptr<Buku> buku;
-        if (isISBN) {
-            buku = cariBukuBerdasarkanISBN(identifikasi);
-        } else {
-            buku = cariBukuBerdasarkanJudul(identifikasi);
-        }
+    void cetakRingkasan(ostream& keluaran, double detik) const {
+        uint64_t total = 0;
+        for (const auto& st : statistik) total += st.jumlah;
 
-        if (buku) {
-            antrianPinjamKembali.push({buku, true});
-            cout << "Permintaan pinjam untuk '" << buku->judul << "' ditambahkan ke antrian." << endl;
-        } else {
-            cout << "Buku dengan identifikasi '" << identifikasi << "' tidak ditemukan." << endl;
+        keluaran << "\n===== Ringkasan Mode Batch =====\n";
+        keluaran << "Perintah dijalankan : " << total << '\n';
+        keluaran << "Baris gagal diurai  : " << barisGagal << '\n';
+        keluaran << "Buku ditemukan      : " << bukuDitemukan << '\n';
+        keluaran << "Waktu total         : " << detik << " detik\n";
+        keluaran << "Throughput          : " << (detik > 0 ? total / detik : 0) << " ops/detik\n";
+        keluaran << "\nPerintah   Jumlah      Rata-rata(ns)  Maks(ns)\n";
+        for (int jenis = 0; jenis < JUMLAH_JENIS_PERINTAH; ++jenis) {
+            const StatistikPerintah& st = statistik[jenis];
+            if (st.jumlah == 0) continue;
+            string baris = namaPerintah(jenis);
+            baris.resize(11, ' ');
+            string jumlah = to_string(st.jumlah);
+            jumlah.resize(12, ' ');
+            string rataRata = to_string(st.totalNs / st.jumlah);
+            rataRata.resize(15, ' ');
+            keluaran << baris << jumlah << rataRata << st.maksNs << '\n';
         }
+        if (Metrik::aktif()) Metrik::cetakTabel(keluaran);
     }
+};
 
-    void ajukanPermintaanKembali(const string& identifikasi, bool isISBN = false) {
-        shared_ptr<Buku> buku;
-        if (isISBN) {
-            buku = cariBukuBerdasarkanISBN(identifikasi);
+// Mode batch: perpustakaan --batch [berkas|-] [--format manusia|tsv|jsonl] [--shard N] [--metrik N]
+int jalankanModeBatch(int argc, char* argv[]) {
+    const char* namaBerkas = "-";
+    bool tampilkanHasil = false;
+    size_t jumlahShard = 0;
+    FormatKeluaran format = FormatKeluaran::Manusia;
+    for (int i = 2; i < argc; ++i) {
+        string argumen = argv[i];
+        if (argumen == "--shard" && i + 1 < argc) {
+            int nilai = 0;
+            if (!keAngka(argv[++i], nilai) || nilai < 1) {
+                cerr << "Jumlah shard tidak valid: " << argv[i] << '\n';
+                return 1;
+            }
+            jumlahShard = nilai;
+        } else if (argumen == "--metrik" && i + 1 < argc) {
+            int sampel = 0;
+            if (!keAngka(argv[++i], sampel) || sampel < 1) {
+                cerr << "Laju sampel metrik tidak valid: " << argv[i] << '\n';
+                return 1;
+            }
+            Metrik::aktifkan(sampel);
+        } else if (argumen == "--format" && i + 1 < argc) {
+            string nilai = argv[++i];
+            tampilkanHasil = true;
+            if (nilai == "tsv") {
+                format = FormatKeluaran::TSV;
+            } else if (nilai == "jsonl") {
+                format = FormatKeluaran::JSONL;
+            } else if (nilai != "manusia") {
+                cerr << "Format tidak dikenal: " << nilai << '\n';
+                return 1;
+            }
         } else {
-            buku = cariBukuBerdasarkanJudul(identifikasi);
+            namaBerkas = argv[i];
         }
+    }
 
-        if (buku) {
-            antrianPinjamKembali.push({buku, false});
-            cout << "Permintaan kembali untuk '" << buku->judul << "' ditambahkan ke antrian." << endl;
-        } else {
-            cout << "Buku dengan identifikasi '" << identifikasi << "' tidak ditemukan." << endl;
-        }
+    FILE* berkas = string(namaBerkas) == "-" ? stdin : fopen(namaBerkas, "rb");
+    if (!berkas) {
+        cerr << "Tidak dapat membuka berkas '" << namaBerkas << "'." << '\n';
+        return 1;
     }
 
-    void prosesAntrian() {
-        if (antrianPinjamKembali.empty()) {
-            cout << "Antrian pinjam/kembali kosong." << endl;
-            return;
+    Perpustakaan perpustakaan;
+    perpustakaan.aturModeSenyap(true);
+    perpustakaan.aturFormatKeluaran(format);
+    unique_ptr<KatalogBershard> katalogBershard;
+    if (jumlahShard > 0) katalogBershard.reset(new KatalogBershard(jumlahShard));
+    EksekutorBatch eksekutor(perpustakaan, tampilkanHasil, katalogBershard.get());
+
+    auto mulai = chrono::steady_clock::now();
+    eksekutor.jalankanBerkas(berkas);
+    double detik = chrono::duration<double>(chrono::steady_clock::now() - mulai).count();
+    if (berkas != stdin) fclose(berkas);
+
+    cout.flush();
+    eksekutor.cetakRingkasan(cerr, detik);
+    return 0;
+}
+
+#ifdef __linux__
+// --- Mode Server ---
+// Protokol baris: perintah teks yang sama dengan mode batch, boleh dikirim
+// beruntun tanpa menunggu jawaban (pipelining). Setiap perintah dijawab sesuai
+// urutan dengan "OK <n>" diikuti n baris TSV buku, atau "ERR <alasan>".
+// Perintah M menjawab n baris TSV metrik (lihat Metrik::tulisTSV), perintah L
+// n baris TSV memori (lihat Perpustakaan::tulisMemoriTSV).
+// Alamat: "unix:<path>" atau "tcp:<port>" (hanya 127.0.0.1).
+
+// Mengubah teks alamat menjadi sockaddr; false jika formatnya salah
+bool uraiAlamat(const string& alamat, sockaddr_storage& hasil, socklen_t& panjang) {
+    memset(&hasil, 0, sizeof(hasil));
+    if (alamat.rfind("unix:", 0) == 0) {
+        sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&hasil);
+        string path = alamat.substr(5);
+        if (path.empty() || path.size() >= sizeof(un->sun_path)) return false;
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        panjang = sizeof(sockaddr_un);
+        return true;
+    }
+    if (alamat.rfind("tcp:", 0) == 0) {
+        int port = 0;
+        if (!keAngka(string_view(alamat).substr(4), port) || port <= 0 || port > 65535) return false;
+        sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&hasil);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(static_cast<uint16_t>(port));
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        panjang = sizeof(sockaddr_in);
+        return true;
+    }
+    return false;
+}
+
+// --- Definisi Kelas ServerPerpustakaan ---
+// Satu thread event loop (epoll) menerima koneksi dan membaca/menulis socket;
+// baris perintah yang lengkap dikirim per batch ke thread pekerja. Tiap koneksi
+// hanya punya satu batch yang sedang diproses agar urutan jawaban terjaga,
+// sementara koneksi yang berbeda dilayani paralel. Perintah baca dilayani dari
+// snapshot katalog tanpa kunci; perintah tulis diserialkan oleh satu mutex
+// dan menerbitkan snapshot baru, jadi pembaca tidak pernah menunggu penulis.
+class ServerPerpustakaan {
+private:
+    struct Koneksi {
+        int fd;
+        string masuk;        // Byte yang sudah dibaca tapi belum dikirim ke pekerja
+        string keluar;       // Jawaban yang menunggu ditulis
+        size_t terkirim = 0;
+        string tugas;        // Baris yang sedang dikerjakan pekerja
+        string hasil;        // Jawaban dari pekerja
+        bool diproses = false;
+        bool selesaiBaca = false; // Klien sudah menutup sisi tulisnya
+        bool rusak = false;
+        uint32_t minat = 0;       // Event epoll yang sedang didaftarkan
+
+        explicit Koneksi(int fd) : fd(fd) {}
+    };
+
+    static constexpr size_t BATAS_MASUK = 4 << 20; // Berhenti membaca jika klien terlalu jauh di depan
+
+    Perpustakaan& perpustakaan;
+    string alamat;
+    size_t jumlahPekerja;
+    mutex kunciTulis; // Hanya penulis; pembaca memakai snapshot
+    atomic<bool> pemadatanBerjalan{false}; // Sisa padatkan(); pembaca snapshot tidak ikut mengerjakannya
+
+    int fdDengar = -1;
+    int fdEpoll = -1;
+    map<int, unique_ptr<Koneksi>> daftarKoneksi;
+
+    mutex kunciAntrian;
+    condition_variable adaTugas;
+    deque<Koneksi*> antrianTugas;
+    vector<Koneksi*> tugasSelesai;
+    bool berhenti = false;
+    vector<thread> pekerja;
+
+    static int fdBangun; // eventfd: pekerja selesai atau sinyal berhenti
+    static volatile sig_atomic_t sinyalDiterima;
+
+    static void tanganiSinyal(int) {
+        int errnoLama = errno; // write() di handler tidak boleh merusak errno thread utama
+        sinyalDiterima = 1;
+        uint64_t satu = 1;
+        ssize_t diabaikan = write(fdBangun, &satu, sizeof(satu));
+        (void)diabaikan;
+        errno = errnoLama;
+    }
+
+    void aturMinat(Koneksi& k) {
+        uint32_t minat = 0;
+        if (!k.selesaiBaca && k.masuk.size() < BATAS_MASUK) minat |= EPOLLIN;
+        if (k.terkirim < k.keluar.size()) minat |= EPOLLOUT;
+        if (minat == k.minat) return;
+        epoll_event ev{};
+        ev.events = minat;
+        ev.data.fd = k.fd;
+        epoll_ctl(fdEpoll, EPOLL_CTL_MOD, k.fd, &ev);
+        k.minat = minat;
+    }
+
+    void tutupKoneksi(Koneksi& k) {
+        epoll_ctl(fdEpoll, EPOLL_CTL_DEL, k.fd, nullptr);
+        close(k.fd);
+        daftarKoneksi.erase(k.fd);
+    }
+
+    // Menutup koneksi jika tidak ada lagi yang perlu dikerjakan; true jika ditutup
+    bool tutupJikaSelesai(Koneksi& k) {
+        if (k.diproses) return false;
+        bool kosong = k.terkirim == k.keluar.size() && k.masuk.find('\n') == string::npos;
+        if (k.rusak || (k.selesaiBaca && kosong)) {
+            tutupKoneksi(k);
+            return true;
         }
+        return false;
+    }
 
-        cout << "\n--- Memproses Antrian ---" << endl;
-        while (!antrianPinjamKembali.empty()) {
-            pair<shared_ptr<Buku>, bool> permintaan = antrianPinjamKembali.front();
-            antrianPinjamKembali.pop();
+    void kirimTugas(Koneksi& k) {
+        if (k.diproses || k.rusak) return;
+        if (k.selesaiBaca && !k.masuk.empty() && k.masuk.back() != '\n') {
+            k.masuk += '\n'; // Baris terakhir tanpa newline
+        }
+        size_t posisi = k.masuk.rfind('\n');
+        if (posisi == string::npos) return;
 
-            shared_ptr<Buku> buku = permintaan.first;
-            bool isPinjam = permintaan.second;
+        k.tugas.assign(k.masuk, 0, posisi + 1);
+        k.masuk.erase(0, posisi + 1);
+        k.diproses = true;
+        {
+            lock_guard<mutex> kunci(kunciAntrian);
+            antrianTugas.push_back(&k);
+        }
+        adaTugas.notify_one();
+    }
 
-            if (buku == nullptr) { // Tambahan: Periksa jika pointer buku itu sendiri null
-                cout << "Error: Buku dalam antrian tidak valid." << endl;
+    void tulisKoneksi(Koneksi& k) {
+        while (k.terkirim < k.keluar.size()) {
+            ssize_t n = send(k.fd, k.keluar.data() + k.terkirim, k.keluar.size() - k.terkirim, MSG_NOSIGNAL);
+            if (n > 0) {
+                k.terkirim += n;
+            } else if (n < 0 && errno == EINTR) {
                 continue;
-            }
-
-            if (isPinjam) {
-                if (buku->pinjamBuku()) {
-                    tumpukanUndo.push({buku, true});
-                    cout << "Berhasil meminjam: " << buku->judul << endl;
-                } else {
-                    cout << "Gagal meminjam: " << buku->judul << " (Tidak ada stok)" << endl;
-                }
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
             } else {
-                if (buku->kembalikanBuku()) {
-                    tumpukanUndo.push({buku, false});
-                    cout << "Berhasil mengembalikan: " << buku->judul << endl;
-                } else {
-                    cout << "Gagal mengembalikan: " << buku->judul << " (Semua salinan sudah ada)" << endl;
-                }
+                k.rusak = true;
+                return;
             }
         }
-        cout << "-------------------------" << endl;
+        if (k.terkirim == k.keluar.size()) {
+            k.keluar.clear();
+            k.terkirim = 0;
+        }
     }
 
-    void undoTindakanTerakhir() {
-        if (tumpukanUndo.empty()) {
-            cout << "Tidak ada tindakan untuk di-undo." << endl;
-            return;
+    void bacaKoneksi(Koneksi& k) {
+        char blok[64 * 1024];
+        while (k.masuk.size() < BATAS_MASUK) {
+            ssize_t n = recv(k.fd, blok, sizeof(blok), 0);
+            if (n > 0) {
+                k.masuk.append(blok, n);
+            } else if (n == 0) {
+                k.selesaiBaca = true;
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) k.rusak = true;
+                break;
+            }
         }
+    }
 
-        pair<shared_ptr<Buku>, bool> tindakanTerakhir = tumpukanUndo.top();
-        tumpukanUndo.pop();
+    void terimaKoneksi() {
+        while (true) {
+            int fd = accept4(fdDengar, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            int satu = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &satu, sizeof(satu)); // Diabaikan pada socket unix
 
-        shared_ptr<Buku> buku = tindakanTerakhir.first;
-        bool adalahPinjamAsli = tindakanTerakhir.second;
+            auto k = make_unique<Koneksi>(fd);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fd, &ev);
+            k->minat = EPOLLIN;
+            daftarKoneksi[fd] = std::move(k);
+        }
+    }
 
-        if (buku == nullptr) { // Tambahan: Periksa jika pointer buku itu sendiri null
-            cout << "Error: Buku dalam tumpukan undo tidak valid." << endl;
-            return;
+    // Dipanggil di event loop setelah pekerja memberi tanda lewat eventfd
+    void ambilHasil() {
+        vector<Koneksi*> selesai;
+        {
+            lock_guard<mutex> kunci(kunciAntrian);
+            selesai.swap(tugasSelesai);
+        }
+        for (Koneksi* k : selesai) {
+            k->keluar += k->hasil;
+            k->hasil.clear();
+            k->diproses = false;
+            if (!k->rusak) tulisKoneksi(*k);
+            if (tutupJikaSelesai(*k)) continue;
+            kirimTugas(*k);
+            aturMinat(*k);
         }
+    }
 
-        if (adalahPinjamAsli) {
-            if (buku->kembalikanBuku()) {
-                cout << "Undo: Buku '" << buku->judul << "' berhasil dikembalikan." << endl;
+    void layaniTugas(Koneksi& k, Perintah& perintah, string& daftarBuku) {
+        const char* p = k.tugas.data();
+        const char* akhir = p + k.tugas.size();
+        while (const char* nl = static_cast<const char*>(memchr(p, '\n', akhir - p))) {
+            const char* alasan = nullptr;
+            HasilUrai urai = uraiPerintah(p, nl, perintah, alasan);
+            p = nl + 1;
+            if (urai == HasilUrai::KOSONG) continue;
+            if (urai == HasilUrai::GAGAL) {
+                k.hasil += "ERR ";
+                k.hasil += alasan;
+                k.hasil += '\n';
+                continue;
+            }
+            if (perintah.jenis == METRIK) {
+                if (!Metrik::aktif()) {
+                    k.hasil += "ERR metrik tidak aktif\n";
+                    continue;
+                }
+                daftarBuku.clear();
+                size_t baris = Metrik::tulisTSV(daftarBuku);
+                k.hasil += "OK ";
+                k.hasil += to_string(baris);
+                k.hasil += '\n';
+                k.hasil += daftarBuku;
+                continue;
+            }
+            if (perintah.jenis == MEMORI) {
+                daftarBuku.clear();
+                size_t baris;
+                {
+                    lock_guard<mutex> kunci(kunciTulis);
+                    baris = Perpustakaan::tulisMemoriTSV(daftarBuku, perpustakaan.laporanMemori());
+                }
+                k.hasil += "OK ";
+                k.hasil += to_string(baris);
+                k.hasil += '\n';
+                k.hasil += daftarBuku;
+                continue;
+            }
+
+            size_t jumlah = 0;
+            daftarBuku.clear();
+            auto kunjungi = [&](const Buku& buku) {
+                PenyajiBuku::formatBuku(daftarBuku, buku, FormatKeluaran::TSV);
+                ++jumlah;
+            };
+            bool berhasil;
+            if (perintah.hanyaBaca()) {
+                PembacaSnapshot pembaca = perpustakaan.bacaSnapshot();
+                berhasil = jalankanPerintahBaca(pembaca, perintah, kunjungi);
             } else {
-                cout << "Undo gagal: Buku '" << buku->judul << "' tidak dapat dikembalikan." << endl;
+                lock_guard<mutex> kunci(kunciTulis);
+                berhasil = jalankanPerintah(perpustakaan, perintah, kunjungi);
+                pemadatanBerjalan.store(perpustakaan.sedangMemadatkan(), memory_order_relaxed);
             }
-        } else {
-            if (buku->pinjamBuku()) {
-                cout << "Undo: Buku '" << buku->judul << "' berhasil dipinjam kembali." << endl;
+
+            if (berhasil) {
+                k.hasil += "OK ";
+                k.hasil += to_string(jumlah);
+                k.hasil += '\n';
+                k.hasil += daftarBuku;
             } else {
-                cout << "Undo gagal: Buku '" << buku->judul << "' tidak dapat dipinjam kembali." << endl;
+                k.hasil += "ERR ditolak\n";
             }
         }
     }
 
-    void rekomendasikanBuku(const string& kriteria, bool isGenre = true) {
-        vector<shared_ptr<Buku>> hasilRekomendasi;
+    void jalankanPekerja() {
+        Perintah perintah;  // Buffer kolom per thread
+        string daftarBuku;
+        while (true) {
+            Koneksi* k;
+            {
+                unique_lock<mutex> kunci(kunciAntrian);
+                adaTugas.wait(kunci, [this] { return berhenti || !antrianTugas.empty(); });
+                if (berhenti) return;
+                k = antrianTugas.front();
+                antrianTugas.pop_front();
+            }
+            layaniTugas(*k, perintah, daftarBuku);
+            {
+                lock_guard<mutex> kunci(kunciAntrian);
+                tugasSelesai.push_back(k);
+            }
+            uint64_t satu = 1;
+            ssize_t diabaikan = write(fdBangun, &satu, sizeof(satu));
+            (void)diabaikan;
+        }
+    }
 
-        if (isGenre) {
-            // Rekomendasi berdasarkan genre
-            cout << "\n--- Rekomendasi Buku dalam Genre '" << kriteria << "' ---" << endl;
-            hasilRekomendasi = pohonGenre.dapatkanBukuBerdasarkanGenre(kriteria);
-        } else {
-            // Rekomendasi berdasarkan tahun rilis
-            int tahun;
-            try {
-                tahun = stoi(kriteria); // Konversi string kriteria ke int tahun
-            } catch (const std::invalid_argument& e) {
-                cout << "Error: Input tahun rilis tidak valid (bukan angka). " << e.what() << endl;
-                return;
-            } catch (const std::out_of_range& e) {
-                cout << "Error: Input tahun rilis di luar jangkauan. " << e.what() << endl;
-                return;
+    // Detak event loop: lanjutkan padatkan() walau tidak ada perintah tulis.
+    // Jika pekerja sedang memegang kunci, langkahnya menunggu detak berikutnya.
+    void langkahPadatkan() {
+        if (!pemadatanBerjalan.load(memory_order_relaxed)) return;
+        unique_lock<mutex> kunci(kunciTulis, try_to_lock);
+        if (!kunci.owns_lock()) return;
+        perpustakaan.pemadatanIndeks();
+        pemadatanBerjalan.store(perpustakaan.sedangMemadatkan(), memory_order_relaxed);
+    }
+
+    bool siapkanSocket() {
+        sockaddr_storage sa;
+        socklen_t panjang;
+        if (!uraiAlamat(alamat, sa, panjang)) {
+            cerr << "Alamat tidak valid: " << alamat << " (gunakan unix:<path> atau tcp:<port>)" << '\n';
+            return false;
+        }
+        if (sa.ss_family == AF_UNIX) {
+            unlink(reinterpret_cast<sockaddr_un*>(&sa)->sun_path);
+        }
+        fdDengar = socket(sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int satu = 1;
+        setsockopt(fdDengar, SOL_SOCKET, SO_REUSEADDR, &satu, sizeof(satu));
+        if (fdDengar < 0 || ::bind(fdDengar, reinterpret_cast<sockaddr*>(&sa), panjang) < 0 || listen(fdDengar, SOMAXCONN) < 0) {
+            cerr << "Gagal membuka socket " << alamat << ": " << strerror(errno) << '\n';
+            return false;
+        }
+
+        fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+        fdBangun = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fdDengar;
+        epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdDengar, &ev);
+        ev.data.fd = fdBangun;
+        epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdBangun, &ev);
+        return true;
+    }
+
+public:
+    ServerPerpustakaan(Perpustakaan& perpustakaan, const string& alamat, size_t jumlahPekerja)
+        : perpustakaan(perpustakaan), alamat(alamat), jumlahPekerja(jumlahPekerja) {}
+
+    int jalankan() {
+        if (!siapkanSocket()) return 1;
+        signal(SIGINT, tanganiSinyal);
+        signal(SIGTERM, tanganiSinyal);
+        perpustakaan.aturModeSenyap(true);
+        perpustakaan.aktifkanSnapshot();
+
+        for (size_t i = 0; i < jumlahPekerja; ++i) {
+            pekerja.emplace_back(&ServerPerpustakaan::jalankanPekerja, this);
+        }
+        cerr << "Server mendengarkan di " << alamat << " dengan " << jumlahPekerja << " pekerja" << '\n';
+
+        epoll_event events[256];
+        while (!sinyalDiterima) {
+            int n = epoll_wait(fdEpoll, events, 256, pemadatanBerjalan.load(memory_order_relaxed) ? 1 : -1);
+            langkahPadatkan();
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == fdDengar) {
+                    terimaKoneksi();
+                    continue;
+                }
+                if (fd == fdBangun) {
+                    uint64_t nilai;
+                    ssize_t diabaikan = read(fdBangun, &nilai, sizeof(nilai));
+                    (void)diabaikan;
+                    ambilHasil();
+                    continue;
+                }
+
+                auto it = daftarKoneksi.find(fd);
+                if (it == daftarKoneksi.end()) continue; // Sudah ditutup di iterasi ini
+                Koneksi& k = *it->second;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) bacaKoneksi(k);
+                if (events[i].events & EPOLLOUT) tulisKoneksi(k);
+                if (tutupJikaSelesai(k)) continue;
+                kirimTugas(k);
+                aturMinat(k);
             }
-            cout << "\n--- Rekomendasi Buku dari Tahun Rilis " << tahun << " ---" << endl;
-            hasilRekomendasi = cariBukuBerdasarkanTahunRilis(tahun);
         }
 
-        if (!hasilRekomendasi.empty()) {
-            for (shared_ptr<Buku> buku : hasilRekomendasi) {
-                // Tambahan: Pastikan shared_ptr tidak null sebelum diakses
-                if (buku) { 
-                    buku->tampilkanInfoBuku();
-                    cout << "---------------------------------" << endl;
+        {
+            lock_guard<mutex> kunci(kunciAntrian);
+            berhenti = true;
+        }
+        adaTugas.notify_all();
+        for (auto& t : pekerja) t.join();
+        for (auto& pasangan : daftarKoneksi) close(pasangan.first);
+        daftarKoneksi.clear();
+        close(fdDengar);
+        close(fdEpoll);
+        close(fdBangun);
+        if (alamat.rfind("unix:", 0) == 0) unlink(alamat.c_str() + 5);
+        cerr << "Server berhenti." << '\n';
+        return 0;
+    }
+};
+
+int ServerPerpustakaan::fdBangun = -1;
+volatile sig_atomic_t ServerPerpustakaan::sinyalDiterima = 0;
+
+// --- Definisi Kelas GeneratorBeban ---
+// Klien uji beban: mengisi katalog lalu menjalankan campuran baca/tulis dari
+// beberapa koneksi dengan pipelining, dan melaporkan throughput serta latensi.
+class GeneratorBeban {
+private:
+    // Pembaca baris dengan buffer sendiri di atas socket blocking
+    class PembacaBaris {
+    private:
+        int fd;
+        string buffer;
+        size_t posisi = 0;
+
+    public:
+        explicit PembacaBaris(int fd) : fd(fd) {}
+
+        bool bacaBaris(string_view& baris) {
+            while (true) {
+                size_t nl = buffer.find('\n', posisi);
+                if (nl != string::npos) {
+                    baris = string_view(buffer).substr(posisi, nl - posisi);
+                    posisi = nl + 1;
+                    return true;
                 }
+                buffer.erase(0, posisi);
+                posisi = 0;
+                char blok[64 * 1024];
+                ssize_t n = recv(fd, blok, sizeof(blok), 0);
+                if (n <= 0) return false;
+                buffer.append(blok, n);
             }
+        }
+    };
+
+    string alamat;
+    size_t jumlahKoneksi;
+    size_t jumlahPermintaan;
+    size_t kedalamanPipeline;
+    size_t jumlahBuku;
+
+    static uint64_t acak(uint64_t& keadaan) { // splitmix64
+        uint64_t z = (keadaan += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static string isbnKe(uint64_t i) {
+        string isbn = to_string(9780000000000ULL + i);
+        return isbn;
+    }
+
+    int sambung() const {
+        sockaddr_storage sa;
+        socklen_t panjang;
+        if (!uraiAlamat(alamat, sa, panjang)) return -1;
+        int fd = socket(sa.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, reinterpret_cast<sockaddr*>(&sa), panjang) < 0) {
+            close(fd);
+            return -1;
+        }
+        int satu = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &satu, sizeof(satu));
+        return fd;
+    }
+
+    static bool kirimSemua(int fd, const string& data) {
+        size_t terkirim = 0;
+        while (terkirim < data.size()) {
+            ssize_t n = send(fd, data.data() + terkirim, data.size() - terkirim, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            terkirim += n;
+        }
+        return true;
+    }
+
+    // Membaca satu jawaban ("OK n" + n baris, atau "ERR ...")
+    static bool bacaJawaban(PembacaBaris& pembaca) {
+        string_view baris;
+        if (!pembaca.bacaBaris(baris)) return false;
+        if (baris.rfind("OK ", 0) != 0) return true;
+        int jumlah = 0;
+        keAngka(baris.substr(3), jumlah);
+        for (int i = 0; i < jumlah; ++i) {
+            if (!pembaca.bacaBaris(baris)) return false;
+        }
+        return true;
+    }
+
+    void tambahPermintaan(string& batch, uint64_t& keadaan) const {
+        uint64_t r = acak(keadaan);
+        uint64_t buku = (r >> 16) % jumlahBuku;
+        unsigned pilihan = r % 100;
+        if (pilihan < 70) {
+            batch += "S\tI\t" + isbnKe(buku) + '\n';
+        } else if (pilihan < 85) {
+            batch += "S\tJ\tJudul " + to_string(buku) + '\n';
+        } else if (pilihan < 86) {
+            batch += "G\tGenre " + to_string(buku % 20) + '\n';
+        } else if (pilihan < 92) {
+            batch += "B\tI\t" + isbnKe(buku) + '\n';
+        } else if (pilihan < 98) {
+            batch += "R\tI\t" + isbnKe(buku) + '\n';
         } else {
-            if (isGenre) {
-                cout << "Tidak ada buku dalam genre '" << kriteria << "'." << endl;
-            } else {
-                cout << "Tidak ada buku yang dirilis pada tahun " << kriteria << "." << endl;
+            batch += "P\n";
+        }
+    }
+
+    bool isiKatalog() const {
+        int fd = sambung();
+        if (fd < 0) return false;
+        PembacaBaris pembaca(fd);
+        bool berhasil = true;
+        for (size_t awal = 0; awal < jumlahBuku && berhasil; awal += 1000) {
+            size_t akhir = min(jumlahBuku, awal + 1000);
+            string batch;
+            for (size_t i = awal; i < akhir; ++i) {
+                batch += "A\tJudul " + to_string(i) + "\tPenulis " + to_string(i % 997) + '\t' + isbnKe(i) +
+                         "\tGenre " + to_string(i % 20) + '\t' + to_string(1900 + i % 125) + "\t3\n";
+            }
+            berhasil = kirimSemua(fd, batch);
+            for (size_t i = awal; i < akhir && berhasil; ++i) {
+                berhasil = bacaJawaban(pembaca);
             }
         }
-        cout << "---------------------------------------------------------" << endl;
+        close(fd);
+        return berhasil;
     }
-    
-    void tampilkanSemuaBuku() const {
-        if (bukuBerdasarkanISBN.empty()) {
-            cout << "Perpustakaan kosong." << endl;
+
+    void jalankanKlien(size_t indeks, size_t jumlah, vector<uint64_t>& latensi, bool& gagal) const {
+        int fd = sambung();
+        if (fd < 0) {
+            gagal = true;
             return;
         }
-        cout << "\n--- Daftar Semua Buku di Perpustakaan ---" << endl;
-        for (const auto& pair : bukuBerdasarkanISBN) {
-            // Tambahan: Pastikan shared_ptr tidak null sebelum diakses
-            if (pair.second) {
-                pair.second->tampilkanInfoBuku(); 
-                cout << "---------------------------------------" << endl;
+        PembacaBaris pembaca(fd);
+        uint64_t keadaan = 0x5EED0000ULL + indeks;
+        string batch;
+        latensi.reserve(jumlah);
+        for (size_t selesai = 0; selesai < jumlah;) {
+            size_t n = min(kedalamanPipeline, jumlah - selesai);
+            batch.clear();
+            for (size_t i = 0; i < n; ++i) tambahPermintaan(batch, keadaan);
+
+            auto mulai = chrono::steady_clock::now();
+            if (!kirimSemua(fd, batch)) {
+                gagal = true;
+                break;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (!bacaJawaban(pembaca)) {
+                    gagal = true;
+                    close(fd);
+                    return;
+                }
+                latensi.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - mulai).count());
+            }
+            selesai += n;
+        }
+        close(fd);
+    }
+
+public:
+    GeneratorBeban(const string& alamat, size_t jumlahKoneksi, size_t jumlahPermintaan, size_t kedalamanPipeline, size_t jumlahBuku)
+        : alamat(alamat), jumlahKoneksi(max<size_t>(1, jumlahKoneksi)), jumlahPermintaan(jumlahPermintaan),
+          kedalamanPipeline(max<size_t>(1, kedalamanPipeline)), jumlahBuku(max<size_t>(1, jumlahBuku)) {}
+
+    int jalankan() {
+        if (!isiKatalog()) {
+            cerr << "Gagal terhubung atau mengisi katalog di " << alamat << '\n';
+            return 1;
+        }
+
+        vector<vector<uint64_t>> latensi(jumlahKoneksi);
+        vector<char> gagal(jumlahKoneksi, 0);
+        vector<thread> klien;
+        auto mulai = chrono::steady_clock::now();
+        for (size_t i = 0; i < jumlahKoneksi; ++i) {
+            size_t bagian = jumlahPermintaan / jumlahKoneksi + (i < jumlahPermintaan % jumlahKoneksi ? 1 : 0);
+            klien.emplace_back([this, i, bagian, &latensi, &gagal] {
+                bool g = false;
+                jalankanKlien(i, bagian, latensi[i], g);
+                gagal[i] = g;
+            });
+        }
+        for (auto& t : klien) t.join();
+        double detik = chrono::duration<double>(chrono::steady_clock::now() - mulai).count();
+
+        vector<uint64_t> semua;
+        for (auto& l : latensi) semua.insert(semua.end(), l.begin(), l.end());
+        sort(semua.begin(), semua.end());
+        auto persentil = [&semua](double p) -> uint64_t {
+            if (semua.empty()) return 0;
+            size_t i = static_cast<size_t>(p * (semua.size() - 1));
+            return semua[i];
+        };
+
+        cout << "===== Hasil Uji Beban =====" << '\n';
+        cout << "Koneksi        : " << jumlahKoneksi << " (pipeline " << kedalamanPipeline << ")" << '\n';
+        cout << "Permintaan     : " << semua.size() << '\n';
+        cout << "Waktu          : " << detik << " detik" << '\n';
+        cout << "Throughput     : " << (detik > 0 ? semua.size() / detik : 0) << " ops/detik" << '\n';
+        cout << "Latensi p50    : " << persentil(0.50) / 1000.0 << " us" << '\n';
+        cout << "Latensi p99    : " << persentil(0.99) / 1000.0 << " us" << '\n';
+        cout << "Latensi p999   : " << persentil(0.999) / 1000.0 << " us" << '\n';
+        cout << "Latensi maks   : " << (semua.empty() ? 0 : semua.back()) / 1000.0 << " us" << '\n';
+        for (char g : gagal) {
+            if (g) {
+                cerr << "Peringatan: sebagian koneksi gagal." << '\n';
+                return 1;
             }
         }
+        return 0;
     }
 };
 
+// perpustakaan --server <alamat> [--pekerja N]
+int jalankanModeServer(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Penggunaan: --server <unix:path|tcp:port> [--pekerja N] [--metrik N]" << '\n';
+        return 1;
+    }
+    size_t jumlahPekerja = max(1u, thread::hardware_concurrency());
+    for (int i = 3; i + 1 < argc; i += 2) {
+        int nilai = 0;
+        if (string(argv[i]) == "--pekerja" && keAngka(argv[i + 1], nilai) && nilai > 0) {
+            jumlahPekerja = nilai;
+        } else if (string(argv[i]) == "--metrik" && keAngka(argv[i + 1], nilai) && nilai > 0) {
+            Metrik::aktifkan(nilai);
+        }
+    }
+    Perpustakaan perpustakaan;
+    ServerPerpustakaan server(perpustakaan, argv[2], jumlahPekerja);
+    return server.jalankan();
+}
+
+// perpustakaan --loadgen <alamat> [--koneksi C] [--permintaan N] [--pipeline D] [--buku B]
+int jalankanModeGeneratorBeban(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Penggunaan: --loadgen <unix:path|tcp:port> [--koneksi C] [--permintaan N] [--pipeline D] [--buku B]" << '\n';
+        return 1;
+    }
+    int koneksi = 4, permintaan = 200000, pipeline = 16, buku = 10000;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        string opsi = argv[i];
+        int nilai = 0;
+        if (!keAngka(argv[i + 1], nilai) || nilai <= 0) continue;
+        if (opsi == "--koneksi") koneksi = nilai;
+        else if (opsi == "--permintaan") permintaan = nilai;
+        else if (opsi == "--pipeline") pipeline = nilai;
+        else if (opsi == "--buku") buku = nilai;
+    }
+    GeneratorBeban generator(argv[2], koneksi, permintaan, pipeline, buku);
+    return generator.jalankan();
+}
+#endif
+
 // Fungsi untuk membersihkan buffer input
 void clearInputBuffer() {
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -296,22 +2633,39 @@ void clearInputBuffer() {
 
 // Fungsi untuk menampilkan menu
 void tampilkanMenu() {
-    cout << "\n===== Sistem Manajemen Perpustakaan =====" << endl;
-    cout << "1. Tambah Buku Baru" << endl;
-    cout << "2. Cari Buku (Judul/ISBN)" << endl; 
-    cout << "3. Ajukan Permintaan Pinjam/Kembali (Judul/ISBN)" << endl; 
-    cout << "4. Proses Antrian Permintaan" << endl;
-    cout << "5. Undo Tindakan Terakhir" << endl;
-    cout << "6. Rekomendasi Buku (Genre/Tahun Rilis)" << endl; 
-    cout << "7. Tampilkan Semua Buku" << endl;
-    cout << "8. Tampilkan Semua Genre" << endl;
-    cout << "9. Keluar" << endl;
-    cout << "=========================================" << endl;
+    cout << "\n===== Sistem Manajemen Perpustakaan =====" << '\n';
+    cout << "1. Tambah Buku Baru" << '\n';
+    cout << "2. Cari Buku (Judul/ISBN)" << '\n'; 
+    cout << "3. Ajukan Permintaan Pinjam/Kembali (Judul/ISBN)" << '\n'; 
+    cout << "4. Proses Antrian Permintaan" << '\n';
+    cout << "5. Undo Tindakan Terakhir" << '\n';
+    cout << "6. Rekomendasi Buku (Genre/Tahun Rilis)" << '\n'; 
+    cout << "7. Tampilkan Semua Buku" << '\n';
+    cout << "8. Tampilkan Semua Genre" << '\n';
+    cout << "9. Hapus Buku (ISBN)" << '\n';
+    cout << "10. Perbarui Buku (ISBN)" << '\n';
+    cout << "11. Keluar" << '\n';
+    cout << "=========================================" << '\n';
     cout << "Pilih opsi: ";
 }
 
 // --- Fungsi Utama (main) ---
-int main() {
+// benchmark.cpp menyertakan berkas ini dan membawa main sendiri
+#ifndef PERPUSTAKAAN_TANPA_MAIN
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false); // cin terikat ke cout, jadi prompt tetap ter-flush sebelum input
+    if (argc >= 2 && string(argv[1]) == "--batch") {
+        return jalankanModeBatch(argc, argv);
+    }
+#ifdef __linux__
+    if (argc >= 2 && string(argv[1]) == "--server") {
+        return jalankanModeServer(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--loadgen") {
+        return jalankanModeGeneratorBeban(argc, argv);
+    }
+#endif
+
     Perpustakaan perpustakaanSaya;
     int pilihan;
     string inputJudul, inputPenulis, inputISBN, inputGenre;
@@ -346,7 +2700,7 @@ int main() {
 
         switch (pilihan) {
             case 1: // Tambah Buku Baru
-                cout << "\n--- Tambah Buku Baru ---" << endl;
+                cout << "\n--- Tambah Buku Baru ---" << '\n';
                 cout << "Masukkan Judul: ";
                 getline(cin, inputJudul);
                 cout << "Masukkan Penulis: ";
@@ -377,7 +2731,7 @@ int main() {
                 break;
 
             case 2: { // Cari Buku (Judul/ISBN)
-                cout << "\n--- Cari Buku ---" << endl;
+                cout << "\n--- Cari Buku ---" << '\n';
                 cout << "Cari berdasarkan (1) Judul atau (2) ISBN? "; 
                 cin >> searchChoice;
                 while (cin.fail() || (searchChoice != 1 && searchChoice != 2)) {
@@ -393,27 +2747,27 @@ int main() {
                     getline(cin, inputIdentifikasi);
                     shared_ptr<Buku> bukuDitemukan = perpustakaanSaya.cariBukuBerdasarkanJudul(inputIdentifikasi);
                     if (bukuDitemukan) {
-                        cout << "\nBuku Ditemukan:" << endl;
+                        cout << "\nBuku Ditemukan:" << '\n';
                         bukuDitemukan->tampilkanInfoBuku();
                     } else {
-                        cout << "Buku dengan judul '" << inputIdentifikasi << "' tidak ditemukan." << endl;
+                        cout << "Buku dengan judul '" << inputIdentifikasi << "' tidak ditemukan." << '\n';
                     }
                 } else { 
                     cout << "Masukkan ISBN Buku: ";
                     getline(cin, inputIdentifikasi);
                     shared_ptr<Buku> bukuDitemukan = perpustakaanSaya.cariBukuBerdasarkanISBN(inputIdentifikasi);
                     if (bukuDitemukan) {
-                        cout << "\nBuku Ditemukan:" << endl;
+                        cout << "\nBuku Ditemukan:" << '\n';
                         bukuDitemukan->tampilkanInfoBuku();
                     } else {
-                        cout << "Buku dengan ISBN '" << inputIdentifikasi << "' tidak ditemukan." << endl;
+                        cout << "Buku dengan ISBN '" << inputIdentifikasi << "' tidak ditemukan." << '\n';
                     }
                 }
                 break;
             }
 
             case 3: { // Ajukan Permintaan Pinjam/Kembali (Judul/ISBN)
-                cout << "\n--- Ajukan Permintaan ---" << endl;
+                cout << "\n--- Ajukan Permintaan ---" << '\n';
                 cout << "Permintaan (1) Pinjam atau (2) Kembali? ";
                 int tipePermintaan;
                 cin >> tipePermintaan;
@@ -461,7 +2815,7 @@ int main() {
                 break;
 
             case 6: { // Rekomendasi Buku (Genre/Tahun Rilis)
-                cout << "\n--- Rekomendasi Buku ---" << endl;
+                cout << "\n--- Rekomendasi Buku ---" << '\n';
                 cout << "Rekomendasi berdasarkan (1) Genre atau (2) Tahun Rilis? "; 
                 cin >> searchChoice;
                 while (cin.fail() || (searchChoice != 1 && searchChoice != 2)) {
@@ -484,23 +2838,73 @@ int main() {
                 break;
             }
 
-            case 7: // Tampilkan Semua Buku
-                perpustakaanSaya.tampilkanSemuaBuku();
+            case 7: // Tampilkan Semua Buku, per halaman
+                perpustakaanSaya.tampilkanSemuaBuku([] {
+                    cout << "Tekan Enter untuk halaman berikutnya, atau 'q' untuk kembali ke menu: ";
+                    string jawaban;
+                    return getline(cin, jawaban) && jawaban != "q" && jawaban != "Q";
+                });
                 break;
 
             case 8: // Tampilkan Semua Genre
-                perpustakaanSaya.pohonGenre.tampilkanSemuaGenre();
+                perpustakaanSaya.tampilkanSemuaGenre();
+                break;
+
+            case 9: // Hapus Buku
+                cout << "\n--- Hapus Buku ---" << '\n';
+                cout << "Masukkan ISBN Buku: ";
+                getline(cin, inputIdentifikasi);
+                perpustakaanSaya.hapusBuku(inputIdentifikasi);
+                break;
+
+            case 10: // Perbarui Buku
+                cout << "\n--- Perbarui Buku ---" << '\n';
+                cout << "Masukkan ISBN Buku yang akan diperbarui: ";
+                getline(cin, inputISBN);
+                if (!perpustakaanSaya.cariBukuBerdasarkanISBN(inputISBN)) {
+                    cout << "Buku dengan ISBN '" << inputISBN << "' tidak ditemukan." << '\n';
+                    break;
+                }
+                cout << "Masukkan Judul Baru: ";
+                getline(cin, inputJudul);
+                cout << "Masukkan Penulis Baru: ";
+                getline(cin, inputPenulis);
+                cout << "Masukkan Genre Baru: ";
+                getline(cin, inputGenre);
+                cout << "Masukkan Tahun Rilis Baru: ";
+                cin >> inputTahunRilis;
+                while (cin.fail() || inputTahunRilis <= 0 || inputTahunRilis > 2025) {
+                    cout << "Tahun rilis tidak valid. Mohon masukkan angka positif dan tidak lebih dari 2025: ";
+                    cin.clear();
+                    clearInputBuffer();
+                    cin >> inputTahunRilis;
+                }
+                clearInputBuffer();
+                cout << "Masukkan Kuantitas Baru: ";
+                cin >> inputKuantitas;
+                while (cin.fail() || inputKuantitas <= 0) {
+                    cout << "Kuantitas tidak valid. Mohon masukkan angka positif: ";
+                    cin.clear();
+                    clearInputBuffer();
+                    cin >> inputKuantitas;
+                }
+                clearInputBuffer();
+                perpustakaanSaya.perbaruiBuku(inputISBN, inputJudul, inputPenulis, inputGenre, inputTahunRilis, inputKuantitas);
                 break;
 
-            case 9: // Keluar
-                cout << "Terima kasih telah menggunakan Sistem Manajemen Perpustakaan. Sampai jumpa!" << endl;
+            case 11: // Keluar
+                cout << "Terima kasih telah menggunakan Sistem Manajemen Perpustakaan. Sampai jumpa!" << '\n';
                 break;
 
             default:
-                cout << "Pilihan tidak valid. Mohon masukkan angka antara 1 dan 9." << endl;
+                cout << "Pilihan tidak valid. Mohon masukkan angka antara 1 dan 11." << '\n';
                 break;
         }
-    } while (pilihan != 9);
+
+        // Sisa pemadatan indeks dikerjakan sedikit demi sedikit di sela menu
+        perpustakaanSaya.pemadatanIndeks();
+    } while (pilihan != 11);
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+// Daftar per halaman: seekRank pada mesin katalog (indeks map dan BST) memberi
+// buku di peringkat yang sama dengan model terurut, visitPage melanjutkan
+// halaman tanpa mengulang atau melewatkan buku, dan tampilkanSemuaBuku
+// Perpustakaan menampilkan setiap buku sekali, berhenti saat lanjut() false,
+// dan tetap urut ketika buku ditambah atau dihapus di antara halaman.
+//
+//   g++ -std=c++17 -O2 -pthread tests/uji_halaman.cpp -o uji_halaman && ./uji_halaman
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "../perpustakaan.cpp"
+
+#include <sstream>
+
+namespace {
+
+size_t gagal = 0;
+
+void periksa(bool kondisi, const string& keterangan) {
+    if (kondisi) return;
+    cerr << "GAGAL: " << keterangan << '\n';
+    gagal++;
+}
+
+string isbnKe(int i) {
+    string angka = to_string(i);
+    return "B" + string(3 - angka.size(), '0') + angka;
+}
+
+template <typename Mesin>
+void ujiMesin(const char* nama) {
+    Mesin mesin;
+    vector<string> urutISBN, urutJudul;
+    // ISBN acak terhadap judul, dan tidak disisipkan berurutan
+    for (int i = 0; i < 37; ++i) {
+        int n = (i * 17) % 37;
+        auto buku = make_shared<Buku>("Judul " + to_string((n * 5) % 37), "Penulis", isbnKe(n), "Fiksi", 2000, 1);
+        mesin.insert(buku);
+    }
+    mesin.visitAll(false, [&urutISBN](const shared_ptr<Buku>& buku) { urutISBN.push_back(buku->ISBN); });
+    mesin.visitAll(true, [&urutJudul](const shared_ptr<Buku>& buku) { urutJudul.push_back(buku->ISBN); });
+    string awal = string(nama) + ": ";
+
+    for (bool berdasarkanJudul : {false, true}) {
+        const vector<string>& urut = berdasarkanJudul ? urutJudul : urutISBN;
+        string urutan = berdasarkanJudul ? "judul" : "ISBN";
+        for (size_t peringkat = 0; peringkat <= urut.size() + 2; ++peringkat) {
+            auto kursor = mesin.seekRank(peringkat, berdasarkanJudul);
+            string didapat = kursor.valid() ? kursor.record()->ISBN : "-";
+            string harapan = peringkat < urut.size() ? urut[peringkat] : "-";
+            periksa(didapat == harapan, awal + "seekRank " + to_string(peringkat) + " urut " + urutan);
+        }
+
+        for (size_t ukuranHalaman : {1, 5, 36, 37, 100}) {
+            vector<string> didapat;
+            auto kursor = mesin.first(berdasarkanJudul);
+            size_t halaman = 0;
+            while (size_t n = Mesin::visitPage(kursor, ukuranHalaman, [&didapat](const Buku& buku) { didapat.push_back(buku.ISBN); })) {
+                periksa(n == min(ukuranHalaman, urut.size() - halaman * ukuranHalaman), awal + "isi halaman " + to_string(halaman));
+                halaman++;
+            }
+            periksa(didapat == urut, awal + "halaman " + to_string(ukuranHalaman) + " urut " + urutan);
+            periksa(halaman == (urut.size() + ukuranHalaman - 1) / ukuranHalaman, awal + "jumlah halaman " + to_string(ukuranHalaman));
+        }
+    }
+
+    auto kursor = mesin.seek(isbnKe(10), false);
+    periksa(kursor.valid() && kursor.record()->ISBN == isbnKe(10), awal + "seek ISBN");
+    kursor = mesin.seek("B010x", false);
+    periksa(kursor.valid() && kursor.record()->ISBN == isbnKe(11), awal + "seek di antara dua ISBN");
+    kursor = mesin.seek("C", false);
+    periksa(!kursor.valid(), awal + "seek setelah ISBN terakhir");
+}
+
+// Mengumpulkan ISBN (kolom pertama TSV) dari keluaran tampilkanSemuaBuku
+template <typename Fungsi>
+vector<string> daftarSemua(Perpustakaan& perpustakaan, size_t ukuranHalaman, Fungsi lanjut) {
+    ostringstream keluaran;
+    streambuf* asal = cout.rdbuf(keluaran.rdbuf());
+    perpustakaan.tampilkanSemuaBuku(lanjut, ukuranHalaman);
+    cout.rdbuf(asal);
+
+    vector<string> isbn;
+    istringstream baris(keluaran.str());
+    for (string satu; getline(baris, satu);) {
+        size_t tab = satu.find('\t');
+        if (tab != string::npos) isbn.push_back(satu.substr(0, tab));
+    }
+    return isbn;
+}
+
+void ujiPerpustakaan() {
+    Perpustakaan perpustakaan;
+    perpustakaan.aturModeSenyap(true);
+    perpustakaan.aturFormatKeluaran(FormatKeluaran::TSV);
+    periksa(daftarSemua(perpustakaan, 20, [] { return true; }).empty(), "perpustakaan kosong");
+
+    vector<string> semua;
+    for (int i = 44; i >= 0; --i) {
+        perpustakaan.tambahBuku("Judul " + to_string(i), "Penulis", isbnKe(i * 2), "Fiksi", 2000, 1);
+    }
+    for (int i = 0; i < 45; ++i) semua.push_back(isbnKe(i * 2));
+
+    size_t panggilan = 0;
+    auto hasil = daftarSemua(perpustakaan, 20, [&panggilan] { panggilan++; return true; });
+    periksa(hasil == semua, "semua buku sekali, urut ISBN");
+    periksa(panggilan == 2, "lanjut() dipanggil sebelum halaman 2 dan 3 saja");
+
+    hasil = daftarSemua(perpustakaan, 20, [] { return false; });
+    periksa(hasil == vector<string>(semua.begin(), semua.begin() + 20), "berhenti setelah halaman pertama");
+
+    hasil = daftarSemua(perpustakaan, 45, [] { return true; });
+    periksa(hasil == semua, "satu halaman penuh");
+
+    // Di antara halaman: hapus awal halaman berikutnya dan satu buku yang sudah
+    // tampil, tambah satu buku sebelum dan satu sesudah posisi daftar
+    bool sudahDiubah = false;
+    hasil = daftarSemua(perpustakaan, 20, [&] {
+        if (!sudahDiubah) {
+            sudahDiubah = true;
+            perpustakaan.hapusBuku(isbnKe(40));
+            perpustakaan.hapusBuku(isbnKe(2));
+            perpustakaan.tambahBuku("Baru", "Penulis", isbnKe(1), "Fiksi", 2000, 1);
+            perpustakaan.tambahBuku("Baru", "Penulis", isbnKe(41), "Fiksi", 2000, 1);
+        }
+        return true;
+    });
+    vector<string> harapan(semua.begin(), semua.begin() + 20);
+    harapan.push_back(isbnKe(41));
+    harapan.insert(harapan.end(), semua.begin() + 21, semua.end());
+    periksa(hasil == harapan, "perubahan di antara halaman");
+}
+
+} // namespace
+
+int main() {
+    ujiMesin<MesinKatalog>("mesin map");
+    ujiMesin<catalog::Engine<Buku, catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets,
+                             catalog::SingleThreaded, catalog::CollatedKey>>("mesin bst");
+    ujiPerpustakaan();
+    if (gagal > 0) {
+        cerr << gagal << " pemeriksaan gagal" << '\n';
+        return 1;
+    }
+    cout << "Semua pemeriksaan halaman lolos" << '\n';
+    return 0;
+}
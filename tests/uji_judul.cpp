@@ -0,0 +1,157 @@
+// Pencarian judul: variasi penulisan (huruf besar/kecil, aksen, spasi, artikel
+// awal) menemukan buku yang sama, dan setiap buku hidup tetap bisa dicari
+// lewat judulnya setelah buku lain dengan judul yang sama dihapus atau
+// diperbarui. Diuji pada mesin katalog dengan indeks map (MesinKatalog) dan
+// BST (konfigurasi library.cpp), pada snapshot mode server, dan pada katalog
+// bershard.
+//
+//   g++ -std=c++17 -O2 -pthread tests/uji_judul.cpp -o uji_judul && ./uji_judul
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "../perpustakaan.cpp"
+
+namespace {
+
+size_t gagal = 0;
+
+void periksa(bool kondisi, const string& keterangan) {
+    if (kondisi) return;
+    cerr << "GAGAL: " << keterangan << '\n';
+    gagal++;
+}
+
+string isbnDari(const Buku* buku) {
+    return buku ? buku->ISBN : "-";
+}
+
+string isbnDari(const shared_ptr<Buku>& buku) {
+    return isbnDari(buku.get());
+}
+
+template <typename Mesin>
+void ujiMesin(const char* nama) {
+    Mesin mesin;
+    auto buat = [](const string& judul, const string& ISBN) {
+        return make_shared<Buku>(judul, "Penulis", ISBN, "Fiksi", 2000, 1);
+    };
+    auto dua = buat("X", "2"), tiga = buat("X", "3"), empat = buat("X", "4");
+    mesin.insert(dua);
+    mesin.insert(tiga);
+    mesin.insert(empat);
+    string awal = string(nama) + ": ";
+    periksa(isbnDari(mesin.findByTitle("X")) == "2", awal + "judul ganda menunjuk ISBN terkecil");
+
+    mesin.remove(tiga);
+    periksa(isbnDari(mesin.findByTitle("X")) == "2", awal + "hapus buku bukan pertama");
+    mesin.remove(dua);
+    periksa(isbnDari(mesin.findByTitle("X")) == "4", awal + "hapus buku pertama, sisanya tetap ditemukan");
+    mesin.remove(empat);
+    periksa(mesin.findByTitle("X") == nullptr, awal + "semua buku dengan judul itu dihapus");
+
+    // Daftar urut judul memuat semua buku, termasuk yang judulnya sama
+    mesin.insert(buat("Y", "9"));
+    mesin.insert(buat("Y", "8"));
+    string urutan;
+    mesin.visitAll(true, [&urutan](const shared_ptr<Buku>& buku) { urutan += buku->ISBN; });
+    periksa(urutan == "89", awal + "daftar urut judul memuat setiap buku");
+    while (mesin.compact(1)) {}
+    mesin.rebuild();
+    while (mesin.compact(1)) {}
+    periksa(isbnDari(mesin.findByTitle("Y")) == "8", awal + "pencarian judul setelah pemadatan");
+
+    auto hobbit = buat("The Hobbit", "5");
+    mesin.insert(hobbit);
+    for (const char* variasi : {"The Hobbit", "the hobbit", "Hobbit", "  HOBBIT ", "Th\xC3\xA9 H\xC3\xB3" "bbit", "A Hobbit"}) {
+        periksa(isbnDari(mesin.findByTitle(variasi)) == "5", awal + "variasi judul '" + variasi + "'");
+    }
+    for (const char* lain : {"Hobbits", "Hobbi", "The"}) {
+        periksa(mesin.findByTitle(lain) == nullptr, awal + "judul lain '" + lain + "' tidak cocok");
+    }
+    // Judul berbeda yang kolasinya sama: yang pertama menurut byte aslinya
+    auto pendek = buat("Hobbit", "7");
+    mesin.insert(pendek);
+    periksa(isbnDari(mesin.findByTitle("the hobbit")) == "7", awal + "kolasi sama, judul asli terkecil lebih dulu");
+    mesin.remove(pendek);
+    periksa(isbnDari(mesin.findByTitle("the hobbit")) == "5", awal + "kolasi sama, sisanya tetap ditemukan");
+}
+
+void ujiPerpustakaan() {
+    Perpustakaan perpustakaan;
+    perpustakaan.aturModeSenyap(true);
+    perpustakaan.aktifkanSnapshot();
+    perpustakaan.tambahBuku("X", "Penulis", "2", "Fiksi", 2000, 1);
+    perpustakaan.tambahBuku("X", "Penulis", "3", "Fiksi", 2000, 1);
+    perpustakaan.hapusBuku("3");
+    periksa(isbnDari(perpustakaan.cariBukuBerdasarkanJudul("X")) == "2", "perpustakaan: hapus ISBN 3, ISBN 2 tetap ditemukan");
+    periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("X")) == "2", "snapshot: hapus ISBN 3, ISBN 2 tetap ditemukan");
+
+    perpustakaan.tambahBuku("X", "Penulis", "1", "Fiksi", 2000, 1);
+    perpustakaan.perbaruiBuku("1", "Z", "Penulis", "Fiksi", 2000, 1);
+    periksa(isbnDari(perpustakaan.cariBukuBerdasarkanJudul("X")) == "2", "perpustakaan: judul pindah saat diperbarui");
+    periksa(isbnDari(perpustakaan.cariBukuBerdasarkanJudul("Z")) == "1", "perpustakaan: judul baru hasil perbarui");
+    periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("X")) == "2", "snapshot: judul pindah saat diperbarui");
+    periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("Z")) == "1", "snapshot: judul baru hasil perbarui");
+    periksa(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("X Y") == nullptr, "snapshot: judul lain tidak cocok");
+
+    perpustakaan.tambahBuku("The Hobbit", "Penulis", "5", "Fiksi", 2000, 1);
+    for (const char* variasi : {"the hobbit", "Hobbit", "  HOBBIT "}) {
+        periksa(isbnDari(perpustakaan.cariBukuBerdasarkanJudul(variasi)) == "5", string("perpustakaan: variasi judul '") + variasi + "'");
+        periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul(variasi)) == "5", string("snapshot: variasi judul '") + variasi + "'");
+    }
+    perpustakaan.tambahBuku("Hobbit", "Penulis", "7", "Fiksi", 2000, 1);
+    periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("the hobbit")) == "7", "snapshot: kolasi sama, judul asli terkecil lebih dulu");
+    perpustakaan.hapusBuku("7");
+    periksa(isbnDari(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("the hobbit")) == "5", "snapshot: kolasi sama, sisanya tetap ditemukan");
+    periksa(perpustakaan.bacaSnapshot().cariBukuBerdasarkanJudul("Hobbits") == nullptr, "snapshot: judul lebih panjang tidak cocok");
+}
+
+// Buku dengan judul sama tersebar di beberapa shard
+void ujiBershard() {
+    vector<string> baris = {
+        "A\tX\tPenulis\t2\tFiksi\t2000\t1",
+        "A\tX\tPenulis\t3\tFiksi\t2000\t1",
+        "A\tX\tPenulis\t5\tFiksi\t2000\t1",
+        "D\t2",
+        "S\tJ\tX",
+        "D\t3",
+        "S\tJ\tX",
+        "B\tJ\tX",
+        "D\t5",
+        "S\tJ\tX",
+        "A\tThe Hobbit\tPenulis\t2\tFiksi\t2000\t1",
+        "A\tHobbit\tPenulis\t3\tFiksi\t2000\t1",
+        "S\tJ\tthe hobbit",
+        "D\t3",
+        "S\tJ\tHOBBIT",
+    };
+    vector<Perintah> perintah(baris.size());
+    for (size_t i = 0; i < baris.size(); ++i) {
+        const char* alasan = nullptr;
+        uraiPerintah(baris[i].data(), baris[i].data() + baris[i].size(), perintah[i], alasan);
+    }
+    KatalogBershard bershard(3);
+    vector<KatalogBershard::HasilPerintah> hasil(perintah.size());
+    bershard.jalankanJendela(perintah.data(), hasil.data(), perintah.size());
+    auto ditemukan = [&hasil](size_t i) { return hasil[i].buku.empty() ? string("-") : hasil[i].buku.front().ISBN; };
+    periksa(ditemukan(4) == "3", "bershard: hapus ISBN 2, ISBN 3 ditemukan");
+    periksa(ditemukan(6) == "5", "bershard: hapus ISBN 3, ISBN 5 ditemukan");
+    periksa(hasil[7].berhasil, "bershard: pinjam per judul memakai buku yang tersisa");
+    periksa(ditemukan(9) == "-", "bershard: semua buku dengan judul itu dihapus");
+    periksa(ditemukan(12) == "3", "bershard: kolasi sama di dua shard, judul asli terkecil lebih dulu");
+    periksa(ditemukan(14) == "2", "bershard: variasi judul setelah buku lain dihapus");
+}
+
+} // namespace
+
+int main() {
+    ujiMesin<MesinKatalog>("mesin map");
+    ujiMesin<catalog::Engine<Buku, catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets,
+                             catalog::SingleThreaded, catalog::CollatedKey>>("mesin bst");
+    ujiPerpustakaan();
+    ujiBershard();
+    if (gagal > 0) {
+        cerr << gagal << " pemeriksaan gagal" << '\n';
+        return 1;
+    }
+    cout << "Semua pemeriksaan judul lolos" << '\n';
+    return 0;
+}
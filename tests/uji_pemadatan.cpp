@@ -0,0 +1,166 @@
+// Pemadatan bertahap diselingi tambah/hapus: setelah setiap operasi acak,
+// mesin katalog (indeks map dan BST) dibandingkan dengan model std::map,
+// lewat pencarian ISBN/judul, jumlah buku dan urutan lengkap kedua indeks.
+// Kursor yang dibuat sebelum perubahan atau langkah pemadatan harus terbaca
+// basi, bukan menunjuk simpul yang sudah dipindah atau dibebaskan (jalankan
+// juga dengan -fsanitize=address). Terakhir, hapus/tambah berulang di
+// Perpustakaan tanpa antrian maupun padatkan() tidak boleh menumpuk tombstone.
+//
+//   g++ -std=c++17 -O2 -pthread tests/uji_pemadatan.cpp -o uji_pemadatan && ./uji_pemadatan
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "../perpustakaan.cpp"
+
+#include <random>
+#include <tuple>
+
+namespace {
+
+using KunciModel = tuple<string, string, string>; // (judul kolasi, judul, ISBN), urutan indeks judul
+
+template <typename Mesin>
+bool uji(const char* nama, unsigned benih) {
+    mt19937 acak(benih);
+    Mesin mesin;
+    map<string, shared_ptr<Buku>> model; // ISBN -> buku hidup
+    auto judulAcak = [&acak] {
+        static const char* const awalan[] = {"Judul ", "judul ", "The JUDUL "};
+        return awalan[acak() % 3] + to_string(acak() % 30);
+    };
+
+    auto gagal = [&](size_t langkah, const string& keterangan) {
+        cerr << nama << ", benih " << benih << ", langkah " << langkah << ": " << keterangan << '\n';
+        return false;
+    };
+
+    for (size_t langkah = 0; langkah < 5000; ++langkah) {
+        auto kursor = mesin.first(acak() % 2);
+        bool berubah = true; // Tambah/hapus yang berhasil wajib membuat kursor basi
+        unsigned r = acak() % 100;
+        if (r < 35) {
+            string ISBN = to_string(acak() % 300);
+            auto buku = make_shared<Buku>(judulAcak(), "Penulis", ISBN, "G" + to_string(acak() % 4), 2000, 1);
+            bool diharapkan = model.find(ISBN) == model.end();
+            if (mesin.insert(buku) != diharapkan) return gagal(langkah, "tambah ISBN " + ISBN);
+            if (diharapkan) {
+                model[ISBN] = buku;
+            } else {
+                berubah = false;
+            }
+        } else if (r < 60) {
+            auto it = model.find(to_string(acak() % 300));
+            if (it == model.end()) {
+                berubah = false;
+            } else {
+                mesin.remove(it->second);
+                model.erase(it);
+            }
+        } else if (r < 85) {
+            // Langkah pemadatan boleh membuat kursor basi, tergantung tahapnya
+            berubah = false;
+            mesin.compact(1 + acak() % 8);
+            if (acak() % 50 == 0) mesin.rebuild();
+        } else {
+            berubah = false;
+            string ISBN = to_string(acak() % 300);
+            auto it = model.find(ISBN);
+            if (mesin.findByISBN(ISBN) != (it == model.end() ? nullptr : it->second)) return gagal(langkah, "cari ISBN " + ISBN);
+        }
+
+        if (berubah && !kursor.stale()) return gagal(langkah, "kursor tidak basi setelah perubahan");
+        if (r >= 85 && kursor.stale()) return gagal(langkah, "kursor basi setelah pencarian");
+
+        // Urutan judul model: kolasi, judul asli, lalu ISBN
+        vector<KunciModel> urutanJudul;
+        for (const auto& isi : model) {
+            urutanJudul.emplace_back(catalog::CollatedKey::normalize(isi.second->judul), isi.second->judul, isi.first);
+        }
+        sort(urutanJudul.begin(), urutanJudul.end());
+
+        if (mesin.size() != model.size()) return gagal(langkah, "jumlah buku");
+        string harapan, didapat;
+        for (const auto& isi : model) harapan += isi.first + ",";
+        for (auto k = mesin.first(false); k.valid(); k.next()) didapat += k.record()->ISBN + ",";
+        if (harapan != didapat) return gagal(langkah, "urutan ISBN");
+        harapan.clear();
+        didapat.clear();
+        for (const auto& k : urutanJudul) harapan += get<2>(k) + ",";
+        for (auto k = mesin.first(true); k.valid(); k.next()) didapat += k.record()->ISBN + ",";
+        if (harapan != didapat) return gagal(langkah, "urutan judul");
+
+        // Kursor lama yang tidak basi masih menelusuri seluruh indeksnya
+        if (!kursor.stale()) {
+            size_t jumlah = 0;
+            for (; kursor.valid() && jumlah <= model.size(); kursor.next()) jumlah++;
+            if (jumlah != model.size()) return gagal(langkah, "kursor lama");
+        }
+
+        // Pencarian judul memberi entri pertama dengan kolasi yang sama
+        string judul = judulAcak();
+        string kolasi = catalog::CollatedKey::normalize(judul);
+        auto pertama = lower_bound(urutanJudul.begin(), urutanJudul.end(), KunciModel(kolasi, "", ""));
+        string diharapkan = pertama != urutanJudul.end() && get<0>(*pertama) == kolasi ? get<2>(*pertama) : "-";
+        auto ditemukan = mesin.findByTitle(judul);
+        if ((ditemukan ? ditemukan->ISBN : "-") != diharapkan) return gagal(langkah, "cari judul " + judul);
+    }
+
+    while (mesin.compact(3)) {}
+    mesin.rebuild();
+    while (mesin.compact(3)) {}
+    if (mesin.size() != model.size()) return gagal(0, "jumlah buku setelah pemadatan penuh");
+    return true;
+}
+
+// Bucket genre hanya disapu oleh pemadatan; hapus dan perbarui membawa
+// langkah kecilnya sendiri, jadi buku yang dihapus tidak tertahan selamanya
+bool ujiTanpaPadatkan() {
+    Perpustakaan perpustakaan;
+    perpustakaan.aturModeSenyap(true);
+    auto overheadBuku = [&perpustakaan] {
+        for (const auto& baris : perpustakaan.laporanMemori()) {
+            if (baris.first == "buku") return baris.second.overhead;
+        }
+        return size_t(0);
+    };
+    mt19937 acak(7);
+    size_t berikutnya = 0;
+    vector<string> hidup;
+    for (; berikutnya < 200; ++berikutnya) {
+        hidup.push_back(to_string(berikutnya));
+        perpustakaan.tambahBuku("Judul", "Penulis", hidup.back(), "G" + to_string(berikutnya % 5), 2000, 1);
+    }
+    size_t awal = overheadBuku();
+
+    for (size_t langkah = 0; langkah < 5000; ++langkah) {
+        size_t i = acak() % hidup.size();
+        if (langkah % 2) {
+            perpustakaan.hapusBuku(hidup[i]);
+            hidup[i] = to_string(berikutnya++);
+            perpustakaan.tambahBuku("Judul", "Penulis", hidup[i], "G" + to_string(acak() % 5), 2000, 1);
+        } else {
+            perpustakaan.perbaruiBuku(hidup[i], "Judul baru", "Penulis", "G" + to_string(acak() % 5), 2001, 2);
+        }
+    }
+    if (overheadBuku() > awal + awal / 2) {
+        cerr << "tanpa padatkan: overhead buku " << overheadBuku() << " byte, awalnya " << awal << '\n';
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    size_t gagal = 0;
+    for (unsigned benih = 1; benih <= 4; ++benih) {
+        if (!uji<MesinKatalog>("mesin map", benih)) gagal++;
+        if (!uji<catalog::Engine<Buku, catalog::ViewKey, catalog::BstIndex, catalog::VectorBuckets,
+                                 catalog::SingleThreaded, catalog::CollatedKey>>("mesin bst", benih)) gagal++;
+    }
+    if (!ujiTanpaPadatkan()) gagal++;
+    if (gagal > 0) {
+        cerr << gagal << " pemeriksaan gagal" << '\n';
+        return 1;
+    }
+    cout << "Pemadatan bertahap sesuai model" << '\n';
+    return 0;
+}
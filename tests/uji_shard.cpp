@@ -0,0 +1,113 @@
+// Membandingkan KatalogBershard dengan Perpustakaan tunggal pada aliran
+// perintah acak yang sama: setiap perintah harus memberi hasil yang sama.
+// Judul sengaja dibuat banyak yang ganda, juga dalam ejaan berbeda yang
+// kolasinya sama, agar pencarian dan pinjam/kembali per judul diuji di
+// beberapa shard, ditambah undo setelah PROSES lintas shard.
+//
+//   g++ -std=c++17 -O2 -pthread tests/uji_shard.cpp -o uji_shard && ./uji_shard
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "../perpustakaan.cpp"
+
+#include <random>
+
+namespace {
+
+vector<string> buatAliran(unsigned benih, size_t jumlah) {
+    mt19937 acak(benih);
+    auto isbn = [&] { return "978" + to_string(1000000000 + acak() % 400); };
+    auto judul = [&] { // Ejaan berbeda dengan kolasi yang sama
+        static const char* const awalan[] = {"Judul ", "judul ", "The JUDUL "};
+        return awalan[acak() % 3] + to_string(acak() % 40);
+    };
+    auto genre = [&] { return "G" + to_string(acak() % 6); };
+    auto tahun = [&] { return to_string(1990 + acak() % 8); };
+
+    vector<string> aliran;
+    for (size_t i = 0; i < jumlah; ++i) {
+        unsigned r = acak() % 100;
+        if (r < 25) {
+            aliran.push_back("A\t" + judul() + "\tPenulis\t" + isbn() + "\t" + genre() + "\t" + tahun() + "\t" + to_string(1 + acak() % 3));
+        } else if (r < 30) {
+            aliran.push_back("E\t" + isbn() + "\t" + judul() + "\tPenulis\t" + genre() + "\t" + tahun() + "\t" + to_string(1 + acak() % 4));
+        } else if (r < 35) {
+            aliran.push_back("D\t" + isbn());
+        } else if (r < 50) {
+            aliran.push_back("S\tJ\t" + judul());
+        } else if (r < 55) {
+            aliran.push_back("S\tI\t" + isbn());
+        } else if (r < 67) {
+            aliran.push_back(acak() % 2 ? "B\tJ\t" + judul() : "B\tI\t" + isbn());
+        } else if (r < 77) {
+            aliran.push_back(acak() % 2 ? "R\tJ\t" + judul() : "R\tI\t" + isbn());
+        } else if (r < 85) {
+            aliran.push_back("P");
+        } else if (r < 93) {
+            aliran.push_back("U");
+        } else if (r < 97) {
+            aliran.push_back("G\t" + genre());
+        } else {
+            aliran.push_back("Y\t" + tahun());
+        }
+    }
+    return aliran;
+}
+
+// Hasil dibandingkan berurutan ISBN; urutan genre boleh berbeda antar mode
+string ringkas(bool berhasil, vector<Buku> buku) {
+    sort(buku.begin(), buku.end(), [](const Buku& a, const Buku& b) { return a.ISBN < b.ISBN; });
+    string hasil = berhasil ? "ok" : "ditolak";
+    for (const Buku& b : buku) {
+        hasil += " [" + b.ISBN + " " + b.judul + " " + to_string(b.kuantitasTersedia) + "/" + to_string(b.kuantitasTotal) + "]";
+    }
+    return hasil;
+}
+
+bool uji(unsigned benih, size_t jumlahShard, size_t ukuranJendela) {
+    vector<string> aliran = buatAliran(benih, 6000);
+    vector<Perintah> perintah(aliran.size());
+    for (size_t i = 0; i < aliran.size(); ++i) {
+        const char* alasan = nullptr;
+        if (uraiPerintah(aliran[i].data(), aliran[i].data() + aliran[i].size(), perintah[i], alasan) != HasilUrai::OK) {
+            cerr << "Baris tidak valid: " << aliran[i] << '\n';
+            return false;
+        }
+    }
+
+    Perpustakaan berurutan;
+    berurutan.aturModeSenyap(true);
+    KatalogBershard bershard(jumlahShard);
+    vector<KatalogBershard::HasilPerintah> hasil(perintah.size());
+    for (size_t awal = 0; awal < perintah.size(); awal += ukuranJendela) {
+        bershard.jalankanJendela(&perintah[awal], &hasil[awal], min(ukuranJendela, perintah.size() - awal));
+    }
+
+    for (size_t i = 0; i < perintah.size(); ++i) {
+        vector<Buku> buku;
+        bool berhasil = jalankanPerintah(berurutan, perintah[i], [&buku](const Buku& b) { buku.push_back(b); });
+        string harapan = ringkas(berhasil, buku);
+        string didapat = ringkas(hasil[i].berhasil, hasil[i].buku);
+        if (harapan != didapat) {
+            cerr << "Benih " << benih << ", " << jumlahShard << " shard, perintah " << i << " (" << aliran[i] << ")\n"
+                 << "  berurutan: " << harapan << "\n  bershard : " << didapat << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    size_t gagal = 0;
+    for (unsigned benih = 1; benih <= 8; ++benih) {
+        for (size_t jumlahShard : {1, 2, 3, 8}) {
+            if (!uji(benih, jumlahShard, benih % 2 ? 64 : 1024)) gagal++;
+        }
+    }
+    if (gagal > 0) {
+        cerr << gagal << " kombinasi berbeda dari eksekusi berurutan" << '\n';
+        return 1;
+    }
+    cout << "Semua eksekusi bershard sama dengan eksekusi berurutan" << '\n';
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Penguraian perintah teks: setiap jenis perintah menerima tepat jumlah
+// kolomnya, dan baris dengan kolom lebih atau kurang ditolak dengan alasan.
+//
+//   g++ -std=c++17 -O2 -pthread tests/uji_urai.cpp -o uji_urai && ./uji_urai
+#define PERPUSTAKAAN_TANPA_MAIN
+#include "../perpustakaan.cpp"
+
+namespace {
+
+size_t gagal = 0;
+
+void periksa(const string& baris, HasilUrai harapan) {
+    Perintah perintah;
+    const char* alasan = nullptr;
+    HasilUrai hasil = uraiPerintah(baris.data(), baris.data() + baris.size(), perintah, alasan);
+    if (hasil == harapan && (hasil != HasilUrai::GAGAL || alasan)) return;
+    cerr << "GAGAL: '" << baris << "' diurai " << static_cast<int>(hasil) << ", harapan " << static_cast<int>(harapan) << '\n';
+    gagal++;
+}
+
+} // namespace
+
+int main() {
+    const HasilUrai OK = HasilUrai::OK, GAGAL = HasilUrai::GAGAL, KOSONG = HasilUrai::KOSONG;
+
+    periksa("", KOSONG);
+    periksa("# komentar\tdengan\tkolom", KOSONG);
+
+    // Jumlah kolom yang tepat, juga dengan CRLF
+    for (const char* baris : {"A\tJudul\tPenulis\t1\tFiksi\t2000\t1", "E\t1\tJudul\tPenulis\tFiksi\t2000\t1",
+                              "D\t1", "S\tJ\tJudul", "B\tI\t1", "R\tJ\tJudul", "P", "U", "G\tFiksi", "Y\t2000",
+                              "M", "K", "L", "P\r", "D\t1\r"}) {
+        periksa(baris, OK);
+    }
+
+    // Satu kolom lebih atau kurang
+    for (const char* baris : {"A\tJudul\tPenulis\t1\tFiksi\t2000\t1\tx", "A\tJudul\tPenulis\t1\tFiksi\t2000",
+                              "E\t1\tJudul\tPenulis\tFiksi\t2000\t1\tx", "D", "D\t1\tx", "S\tJ", "S\tJ\tJudul\tx",
+                              "B\tI\t1\tx", "R\tJ\tJudul\tx", "P\tx", "P\t", "U\tx", "G", "G\tFiksi\tx", "Y",
+                              "Y\t2000\tx", "M\tx", "K\tx", "L\tx", "L\t\r",
+                              "A\tJudul\tPenulis\t1\tFiksi\t2000\t1\tx\ty\tz"}) {
+        periksa(baris, GAGAL);
+    }
+
+    periksa("X", GAGAL);
+    periksa("PP", GAGAL);
+    periksa("S\tX\tJudul", GAGAL);
+    periksa("Y\tdua ribu", GAGAL);
+
+    if (gagal > 0) {
+        cerr << gagal << " pemeriksaan gagal" << '\n';
+        return 1;
+    }
+    cout << "Semua pemeriksaan urai lolos" << '\n';
+    return 0;
+}